@@ -8,6 +8,8 @@
 #include "lib/debug.h"
 #include "lib/math.h"
 #include "lib/string.h"
+#include "process/resource.h"
+#include "thread/sync.h"
 #include "thread/thread.h"
 
 #define SUPER_BLOCK_MAGIC 0x12345678
@@ -35,6 +37,17 @@ struct GlobalFileDescript
     } type;
     void* data;
 } global_file_descript[MAX_FILES_OPEN];
+RwLock file_table_lock;  // 保护global_file_descript,查找描述符持有读锁,分配时持有写锁
+
+//在读锁下复制描述符,描述符分配后不再释放,复制后可以在锁外使用
+GlobalFileDescript get_global_file_descript(int32_t global_file_id)
+{
+    ASSERT(0 <= global_file_id && global_file_id < MAX_FILES_OPEN);
+    file_table_lock.read_lock();
+    GlobalFileDescript descript = global_file_descript[global_file_id];
+    file_table_lock.read_unlock();
+    return descript;
+}
 
 Partition* sdb1;
 Partition* sdb2;
@@ -103,7 +116,7 @@ Partition* FileSystem::get_current_partition()
 
 int32_t insert_thread_fd(int fd)
 {
-    auto pcb = Thread::get_current_pcb();
+    auto pcb = Thread::get_current_pcb()->process;  //同一进程的线程共享文件表
     for (int32_t i = 3; i < MAX_FILES_OPEN_PER_THREAD; i++)
     {
         if (pcb->file_table[i] == -1)
@@ -117,6 +130,7 @@ int32_t insert_thread_fd(int fd)
 
 int32_t FileSystem::pipe(int32_t fd[2])
 {
+    file_table_lock.write_lock();
     int32_t index = -1;
     for (int i = 0; i < MAX_FILES_OPEN; i++)
     {
@@ -126,14 +140,17 @@ int32_t FileSystem::pipe(int32_t fd[2])
             break;
         }
     }
-    if (index == -1)
+    //管道是内核对象,受进程的内核对象数限制
+    if (index == -1 || !Resource::charge(Thread::get_current_pcb(), ResourceType::object, 1))
     {
+        file_table_lock.write_unlock();
         return -1;
     }
     global_file_descript[index].type = GlobalFileDescript::pipe;
     global_file_descript[index].data = new Pipe();
-    fd[0]                            = insert_thread_fd(index);
-    fd[1]                            = insert_thread_fd(index);
+    file_table_lock.write_unlock();
+    fd[0] = insert_thread_fd(index);
+    fd[1] = insert_thread_fd(index);
     ASSERT(fd[0] != -1 && fd[1] != -1);
     return 0;
 }
@@ -144,9 +161,7 @@ int32_t FileSystem::read(int32_t fd, void* buffer, uint32_t count)
     ASSERT(0 <= fd && fd < MAX_FILES_OPEN_PER_THREAD);
     ASSERT(fd != (int32_t)STDFD::stdout);
     ASSERT(fd != (int32_t)STDFD::stderr);
-    auto global_file_id = Thread::get_current_pcb()->file_table[fd];
-    ASSERT(0 <= global_file_id && global_file_id < MAX_FILES_OPEN);
-    auto& descript = global_file_descript[global_file_id];
+    auto descript = get_global_file_descript(Thread::get_current_pcb()->process->file_table[fd]);
     if (descript.type == GlobalFileDescript::pipe)
     {
         ASSERT(descript.data != nullptr);
@@ -181,9 +196,7 @@ int32_t FileSystem::write(int32_t fd, const void* buffer, uint32_t count)
 {
     ASSERT(buffer != nullptr);
     ASSERT(0 <= fd && fd < MAX_FILES_OPEN_PER_THREAD);
-    auto global_file_id = Thread::get_current_pcb()->file_table[fd];
-    ASSERT(0 <= global_file_id && global_file_id < MAX_FILES_OPEN);
-    auto& descript = global_file_descript[global_file_id];
+    auto descript = get_global_file_descript(Thread::get_current_pcb()->process->file_table[fd]);
     if (descript.type == GlobalFileDescript::pipe)
     {
         ASSERT(descript.data != nullptr);
@@ -213,8 +226,50 @@ int32_t FileSystem::write(int32_t fd, const void* buffer, uint32_t count)
         return byte_to_read;
     }
 }
+int32_t FileSystem::read_nonblock(int32_t fd, void* buffer, uint32_t count)
+{
+    ASSERT(buffer != nullptr);
+    ASSERT(0 <= fd && fd < MAX_FILES_OPEN_PER_THREAD);
+    auto descript = get_global_file_descript(Thread::get_current_pcb()->process->file_table[fd]);
+    if (descript.type == GlobalFileDescript::pipe)
+    {
+        ASSERT(descript.data != nullptr);
+        return ((Pipe*)descript.data)->try_read(buffer, count);
+    }
+    else if (fd == (int32_t)STDFD::stdin)
+    {
+        char*    data = (char*)buffer;
+        uint32_t i    = 0;
+        for (; i < count; i++)
+        {
+            char key = Keyboard::read_key(false);
+            if (key == -1)
+            {
+                break;
+            }
+            data[i] = key;
+        }
+        return i;
+    }
+    return read(fd, buffer, count);
+}
+
+int32_t FileSystem::write_nonblock(int32_t fd, const void* buffer, uint32_t count)
+{
+    ASSERT(buffer != nullptr);
+    ASSERT(0 <= fd && fd < MAX_FILES_OPEN_PER_THREAD);
+    auto descript = get_global_file_descript(Thread::get_current_pcb()->process->file_table[fd]);
+    if (descript.type == GlobalFileDescript::pipe)
+    {
+        ASSERT(descript.data != nullptr);
+        return ((Pipe*)descript.data)->try_write(buffer, count);
+    }
+    return write(fd, buffer, count);
+}
+
 void FileSystem::init()
 {
+    file_table_lock = RwLock();
     for (int i = 0; i < MAX_FILES_OPEN; i++)
     {
         global_file_descript[i].data = nullptr;
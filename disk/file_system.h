@@ -50,4 +50,7 @@ namespace FileSystem
     int32_t          read(int32_t file_id, void* buffer, uint32_t count);
     int32_t          write(int32_t file_id, const void* buffer, uint32_t count);
     int32_t          pipe(int32_t fd[2]);
+    //不阻塞的读写,管道或键盘暂时没有数据(或管道已满)时返回0,普通文件与read和write相同
+    int32_t read_nonblock(int32_t file_id, void* buffer, uint32_t count);
+    int32_t write_nonblock(int32_t file_id, const void* buffer, uint32_t count);
 }  // namespace FileSystem
@@ -146,8 +146,8 @@ void write2sector(Disk* hd, void* buf, uint8_t sec_cnt)
 bool busy_wait(Disk* hd)
 {
     IDEChannel* channel    = hd->my_channel;
-    uint16_t    time_limit = 30 * 1000;  // 可以等待30000毫秒
-    while (time_limit -= 10 >= 0)
+    int32_t     time_limit = 30 * 1000;  // 可以等待30000毫秒
+    for (; time_limit > 0; time_limit -= 10)
     {
         if (!(inb(reg_status(channel)) & BIT_STAT_BSY))
         {
@@ -387,11 +387,11 @@ void ide_interrupt_handler(uint8_t irq_no)
     if (ch->expecting_intr)
     {
         ch->expecting_intr = false;
-        // semaphore_up(&ch->disk_done);
-        ch->disk_done.up();
         /* 读取状态寄存器使硬盘控制器认为此次的中断已被处理,
          * 从而硬盘可以继续执行新的读写 */
         inb(reg_status(ch));
+        //数据的读写由等待在disk_done上的线程完成,中断中只应答并唤醒它
+        ch->disk_done.up();
     }
 }
 
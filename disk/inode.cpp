@@ -38,13 +38,23 @@ List& Inode::get_list()
     return list;
 }
 
+RwLock& Inode::get_list_lock()
+{
+    static RwLock lock;
+    return lock;
+}
+
 Inode* Inode::copy_instance(Inode* inode)
 {
-    AtomicGuard gurad;
     ASSERT(inode != nullptr);
+    get_list_lock().read_lock();
     ASSERT(get_list().find(inode->list_tag));
-    inode->reference_count++;
+    {
+        AtomicGuard gurad;  //持有读锁的线程可能同时修改引用计数
+        inode->reference_count++;
+    }
     // printkln("copy ref %d %x %d %d", inode->no, inode, inode->reference_count, get_list().get_length());
+    get_list_lock().read_unlock();
     return inode;
 }
 
@@ -60,37 +70,61 @@ void Inode::operator delete(void* p)
     Memory::free_kernel(p);
 }
 
-Inode* Inode::get_instance(Partition* partition, int32_t no)
+Inode* Inode::find_instance(Partition* partition, int32_t no)
 {
-    AtomicGuard gurad;
-    auto&       list = get_list();
-    if (!list.is_empty())
+    auto& list = get_list();
+    if (list.is_empty())
     {
-        auto begin = &list.front();
-        auto end   = list.back().next;
-        ASSERT(begin != nullptr);
-        ASSERT(end != nullptr);
-        for (auto it = begin; it != end; it = it->next)
-        {
-            Inode* inode = (Inode*)((uint32_t)it - (uint32_t)(&((Inode*)0)->list_tag));
-            if (inode->partition == partition && inode->no == no)
-            {  //内存中已经有了inode
-                inode->reference_count++;
-                // printkln("add  ref %d %x %d %d", inode->no, inode, inode->reference_count, list.get_length());
-                return inode;
-            }
+        return nullptr;
+    }
+    auto begin = &list.front();
+    auto end   = list.back().next;
+    ASSERT(begin != nullptr);
+    ASSERT(end != nullptr);
+    for (auto it = begin; it != end; it = it->next)
+    {
+        Inode* inode = (Inode*)((uint32_t)it - (uint32_t)(&((Inode*)0)->list_tag));
+        if (inode->partition == partition && inode->no == no)
+        {  //内存中已经有了inode
+            AtomicGuard gurad;  //持有读锁的线程可能同时修改引用计数
+            inode->reference_count++;
+            // printkln("add  ref %d %x %d %d", inode->no, inode, inode->reference_count, list.get_length());
+            return inode;
         }
     }
-    //内存中不存在inode
-    auto inode = new Inode(partition, no);
-    list.push_front(inode->list_tag);
-    // printkln("add  ref %d %x %d %d", inode->no, inode, inode->reference_count, list.get_length());
+    return nullptr;
+}
+
+Inode* Inode::get_instance(Partition* partition, int32_t no)
+{
+    auto& lock = get_list_lock();
+    lock.read_lock();
+    Inode* inode = find_instance(partition, no);
+    if (inode != nullptr)
+    {
+        lock.read_unlock();
+        return inode;
+    }
+    if (!lock.upgrade())
+    {  //其他读者正在升级,放弃读锁后重新获取写锁,期间链表可能已被修改
+        lock.read_unlock();
+        lock.write_lock();
+        inode = find_instance(partition, no);
+    }
+    if (inode == nullptr)
+    {  //内存中不存在inode
+        inode = new Inode(partition, no);
+        get_list().push_front(inode->list_tag);
+        // printkln("add  ref %d %x %d %d", inode->no, inode, inode->reference_count, get_list().get_length());
+    }
+    lock.write_unlock();
     return inode;
 }
 
 void Inode::remove_instance(Inode* inode)
 {
-    AtomicGuard gurad;
+    auto& lock = get_list_lock();
+    lock.write_lock();
     inode->reference_count--;
     if (inode->reference_count == 0)
     {
@@ -102,6 +136,7 @@ void Inode::remove_instance(Inode* inode)
     {
         // printkln("sub  ref %d %x %d %d", inode->no, inode, inode->reference_count, get_list().get_length());
     }
+    lock.write_unlock();
 }
 
 Inode::~Inode()
@@ -23,8 +23,12 @@ private:
     int32_t&     get_block_index(uint32_t index);
     void         save();
     static List& get_list();
-    void*        operator new(__SIZE_TYPE__ size);
-    void         operator delete(void* p);
+    //保护inode链表,查找时持有读锁,插入和删除时持有写锁
+    static RwLock& get_list_lock();
+    //在链表中查找inode,找到时增加引用计数,需持有链表的锁
+    static Inode* find_instance(class Partition* partition, int32_t no);
+    void*         operator new(__SIZE_TYPE__ size);
+    void          operator delete(void* p);
 
 private:
     Inode(class Partition* partition, int32_t no);
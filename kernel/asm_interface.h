@@ -13,4 +13,52 @@ void    outsw(uint16_t port, const void* addr, uint32_t word_cnt);
 uint8_t inb(uint16_t port);
 void    insw(uint16_t port, void* addr, uint32_t word_cnt);
 void    switch_to(struct PCB* current_thread, struct PCB* next_thread);
-}
\ No newline at end of file
+void    sysenter_handler();
+}
+
+//读取时间戳计数器
+inline uint64_t rdtsc()
+{
+    uint32_t low, high;
+    asm volatile("rdtsc" : "=a"(low), "=d"(high));
+    return ((uint64_t)high << 32) | low;
+}
+
+//执行cpuid指令,leaf为eax的输入值
+inline void cpuid(uint32_t leaf, uint32_t* eax, uint32_t* ebx, uint32_t* ecx, uint32_t* edx)
+{
+    asm volatile("cpuid" : "=a"(*eax), "=b"(*ebx), "=c"(*ecx), "=d"(*edx) : "a"(leaf), "c"(0));
+}
+
+//写模型特定寄存器
+inline void wrmsr(uint32_t msr, uint64_t value)
+{
+    asm volatile("wrmsr" : : "c"(msr), "a"((uint32_t)value), "d"((uint32_t)(value >> 32)));
+}
+
+//自旋等待时提示处理器降低功耗
+inline void cpu_relax()
+{
+    asm volatile("pause" ::: "memory");
+}
+
+//原子地把*address设为value,返回原来的值
+inline uint32_t atomic_exchange(volatile uint32_t* address, uint32_t value)
+{
+    asm volatile("xchgl %0, %1" : "+r"(value), "+m"(*address) : : "memory");
+    return value;
+}
+
+//*address等于expected时原子地设为value,返回原来的值
+inline uint32_t atomic_compare_exchange(volatile uint32_t* address, uint32_t expected, uint32_t value)
+{
+    asm volatile("lock cmpxchgl %2, %1" : "+a"(expected), "+m"(*address) : "r"(value) : "memory");
+    return expected;
+}
+
+//原子地给*address加上value,返回原来的值
+inline uint32_t atomic_fetch_add(volatile uint32_t* address, uint32_t value)
+{
+    asm volatile("lock xaddl %0, %1" : "+r"(value), "+m"(*address) : : "memory");
+    return value;
+}
@@ -40,8 +40,19 @@
 #define SELECTOR_U_CODE ((5 << 3) + (TI_GDT << 2) + RPL3)
 #define SELECTOR_U_DATA ((6 << 3) + (TI_GDT << 2) + RPL3)
 #define SELECTOR_U_STACK SELECTOR_U_DATA
+/* sysenter/sysexit要求依次排列的内核代码段、内核栈段、用户代码段、用户栈段,
+ * 前面的描述符不满足这个顺序,所以在第7到10个位置另外添加 */
+#define SELECTOR_SYSENTER_CS ((7 << 3) + (TI_GDT << 2) + RPL0)
+#define SELECTOR_SYSEXIT_CS ((9 << 3) + (TI_GDT << 2) + RPL3)
+#define SELECTOR_SYSEXIT_SS ((10 << 3) + (TI_GDT << 2) + RPL3)
+//用户线程的线程局部存储段,基址在切换线程时更新,通过gs访问
+#define SELECTOR_U_TLS ((11 << 3) + (TI_GDT << 2) + RPL3)
+//双重错误任务门使用的tss
+#define SELECTOR_DF_TSS ((12 << 3) + (TI_GDT << 2) + RPL0)
 
 #define GDT_ATTR_HIGH ((DESC_G_4K << 7) + (DESC_D_32 << 6) + (DESC_L << 5) + (DESC_AVL << 4))
+#define GDT_CODE_ATTR_LOW_DPL0 ((DESC_P << 7) + (DESC_DPL_0 << 5) + (DESC_S_CODE << 4) + DESC_TYPE_CODE)
+#define GDT_DATA_ATTR_LOW_DPL0 ((DESC_P << 7) + (DESC_DPL_0 << 5) + (DESC_S_DATA << 4) + DESC_TYPE_DATA)
 #define GDT_CODE_ATTR_LOW_DPL3 ((DESC_P << 7) + (DESC_DPL_3 << 5) + (DESC_S_CODE << 4) + DESC_TYPE_CODE)
 #define GDT_DATA_ATTR_LOW_DPL3 ((DESC_P << 7) + (DESC_DPL_3 << 5) + (DESC_S_DATA << 4) + DESC_TYPE_DATA)
 
@@ -56,10 +67,12 @@
 #define IDT_DESC_P 1
 #define IDT_DESC_DPL0 0
 #define IDT_DESC_DPL3 3
-#define IDT_DESC_32_TYPE 0xE  // 32位的门
-#define IDT_DESC_16_TYPE 0x6  // 16位的门，不用，定义它只为和32位门区分
+#define IDT_DESC_32_TYPE 0xE    // 32位的门
+#define IDT_DESC_16_TYPE 0x6    // 16位的门，不用，定义它只为和32位门区分
+#define IDT_DESC_TASK_TYPE 0x5  // 任务门
 #define IDT_DESC_ATTR_DPL0 ((IDT_DESC_P << 7) + (IDT_DESC_DPL0 << 5) + IDT_DESC_32_TYPE)
 #define IDT_DESC_ATTR_DPL3 ((IDT_DESC_P << 7) + (IDT_DESC_DPL3 << 5) + IDT_DESC_32_TYPE)
+#define IDT_DESC_ATTR_TASK ((IDT_DESC_P << 7) + (IDT_DESC_DPL0 << 5) + IDT_DESC_TASK_TYPE)
 
 //---------------    eflags属性    ----------------
 
@@ -0,0 +1,110 @@
+#include "kernel/clock.h"
+#include "kernel/asm_interface.h"
+#include "kernel/interrupt.h"
+#include "kernel/timer.h"
+#include "lib/debug.h"
+#include "lib/math.h"
+
+#define INPUT_FREQUENCY 1193180
+#define PIT_CONTROL_PORT 0x43
+#define COUNTER2_PORT 0x42
+#define COUNTER2_GATE_PORT 0x61  // 第0位控制计数器2的门,第1位控制扬声器,第5位是计数器2的输出
+#define CALIBRATE_MSECONDS 10
+#define CALIBRATE_COUNTS (INPUT_FREQUENCY / 1000 * CALIBRATE_MSECONDS)
+#define CPUID_TSC (1 << 4)  // cpuid 1号功能edx的第4位表示支持tsc
+
+bool     tsc_available;
+uint32_t tsc_khz;
+uint64_t tsc_base;   // 开机时的tsc
+uint32_t tsc_mult;   // 纳秒 = (tsc周期数 * tsc_mult) >> tsc_shift
+uint32_t tsc_shift;  // 在mult不超过32位的前提下尽量大,保证精度
+
+/* 用计数器2的单次模式计时CALIBRATE_MSECONDS毫秒,
+ * 期间经过的tsc周期数即为tsc的频率 */
+uint64_t calibrate_tsc()
+{
+    uint8_t gate = inb(COUNTER2_GATE_PORT);
+    outb(COUNTER2_GATE_PORT, (gate & ~0x02) | 0x01);  //关闭扬声器,打开计数器2的门
+    outb(PIT_CONTROL_PORT, 2 << 6 | 3 << 4 | 0 << 1);  //计数器2,先低后高读写,单次模式
+    outb(COUNTER2_PORT, (uint8_t)CALIBRATE_COUNTS);
+    outb(COUNTER2_PORT, (uint8_t)(CALIBRATE_COUNTS >> 8));
+    uint64_t start = rdtsc();
+    while (!(inb(COUNTER2_GATE_PORT) & 0x20)) {}  //计数到0时输出变为高电平
+    uint64_t end = rdtsc();
+    outb(COUNTER2_GATE_PORT, gate);
+    return end - start;
+}
+
+void Clock::init()
+{
+    printkln("clock init start");
+    ASSERT(!Interrupt::is_enabled());
+    uint32_t eax, ebx, ecx, edx;
+    cpuid(0, &eax, &ebx, &ecx, &edx);
+    if (eax >= 1)
+    {
+        cpuid(1, &eax, &ebx, &ecx, &edx);
+        tsc_available = edx & CPUID_TSC;
+    }
+    if (tsc_available)
+    {
+        uint64_t cycles = calibrate_tsc();
+        tsc_khz         = (uint32_t)div_u64(cycles, CALIBRATE_MSECONDS);
+        tsc_available   = tsc_khz > 0;
+    }
+    if (tsc_available)
+    {
+        tsc_shift = 32;
+        while (tsc_shift > 0 &&
+               div_u64((uint64_t)NSECONDS_PER_SECOND / 1000 << tsc_shift, tsc_khz) > 0xffffffffULL)
+        {
+            tsc_shift--;
+        }
+        tsc_mult = (uint32_t)div_u64((uint64_t)NSECONDS_PER_SECOND / 1000 << tsc_shift, tsc_khz);
+        tsc_base = rdtsc();
+        printkln("tsc frequency %d khz", tsc_khz);
+    }
+    else
+    {
+        printkln("tsc is not available, use timer ticks");
+    }
+    printkln("clock init done");
+}
+
+bool Clock::is_tsc_available()
+{
+    return tsc_available;
+}
+
+uint32_t Clock::get_tsc_khz()
+{
+    return tsc_khz;
+}
+
+void Clock::get_tsc_conversion(uint64_t* base, uint32_t* mult, uint32_t* shift)
+{
+    *base  = tsc_base;
+    *mult  = tsc_mult;
+    *shift = tsc_shift;
+}
+
+uint64_t Clock::now_ns()
+{
+    if (tsc_available)
+    {
+        return mul_u64_u32_shr(rdtsc() - tsc_base, tsc_mult, tsc_shift);
+    }
+    return (uint64_t)Timer::get_ticks() * (NSECONDS_PER_SECOND / IRQ0_FREQUENCY);
+}
+
+int32_t Clock::clock_gettime(TimeSpec* time)
+{
+    if (time == nullptr)
+    {
+        return -1;
+    }
+    uint32_t nanosecond = 0;
+    time->second        = (uint32_t)div_u64(now_ns(), NSECONDS_PER_SECOND, &nanosecond);
+    time->nanosecond    = nanosecond;
+    return 0;
+}
@@ -0,0 +1,24 @@
+#pragma once
+#include "lib/stdint.h"
+
+#define NSECONDS_PER_SECOND 1000000000U
+
+//clock_gettime返回的时间
+struct TimeSpec
+{
+    uint32_t second;
+    uint32_t nanosecond;
+};
+
+//以开机时刻为起点的单调时钟,处理器支持时使用tsc,否则退化为时钟嘀嗒的精度
+namespace Clock
+{
+    //用PIT校准tsc的频率,需要在关中断时调用
+    void     init();
+    bool     is_tsc_available();
+    uint32_t get_tsc_khz();
+    //纳秒 = ((tsc - base) * mult) >> shift,供vdso在用户态换算
+    void     get_tsc_conversion(uint64_t* base, uint32_t* mult, uint32_t* shift);
+    uint64_t now_ns();
+    int32_t  clock_gettime(TimeSpec* time);
+}  // namespace Clock
@@ -0,0 +1,101 @@
+#include "kernel/coroutine.h"
+#include "kernel/interrupt.h"
+#include "lib/debug.h"
+#include "lib/stdio.h"
+
+WorkQueue coroutine_executor;
+
+Coroutine* get_coroutine_by_tag(ListElement* tag)
+{
+    return (Coroutine*)((uint32_t)tag - (uint32_t) & ((Coroutine*)0)->tag);
+}
+
+//在执行器线程中调用协程函数,按返回值决定是否重新排队
+void resume_coroutine(void* arg)
+{
+    Coroutine*      co     = (Coroutine*)arg;
+    CoroutineStatus status = co->function(co);
+    if (status == CoroutineStatus::ready)
+    {
+        coroutine_executor.queue(&co->work);
+    }
+    else if (status == CoroutineStatus::done)
+    {
+        co->done = true;
+    }
+}
+
+//定时器到期,在时钟中断中调用
+void coroutine_timeout(void* arg)
+{
+    coroutine_executor.queue(&((Coroutine*)arg)->work);
+}
+
+void Coroutines::init()
+{
+    printkln("coroutine init start");
+    coroutine_executor.init("coroutine", 0);
+    printkln("coroutine init done");
+}
+
+void Coroutines::init_event(CoroutineEvent* event)
+{
+    event->waiters.init();
+    event->signaled = false;
+}
+
+void Coroutines::spawn(Coroutine* co, CoroutineFunction_t function, void* arg)
+{
+    WorkQueue::init_work(&co->work, resume_coroutine, co);
+    Timer::init_timer(&co->timer, coroutine_timeout, co);
+    co->tag.init();
+    co->function = function;
+    co->arg      = arg;
+    co->line     = 0;
+    co->done     = false;
+    coroutine_executor.queue(&co->work);
+}
+
+void Coroutines::notify_one(CoroutineEvent* event)
+{
+    AtomicGuard guard;
+    if (event->waiters.is_empty())
+    {
+        event->signaled = true;
+        return;
+    }
+    coroutine_executor.queue(&get_coroutine_by_tag(event->waiters.pop_front())->work);
+}
+
+void Coroutines::notify_all(CoroutineEvent* event)
+{
+    AtomicGuard guard;
+    if (event->waiters.is_empty())
+    {
+        event->signaled = true;
+        return;
+    }
+    while (!event->waiters.is_empty())
+    {
+        coroutine_executor.queue(&get_coroutine_by_tag(event->waiters.pop_front())->work);
+    }
+}
+
+//已有未处理的通知时不等待,返回true
+bool Coroutines::wait(Coroutine* co, CoroutineEvent* event)
+{
+    AtomicGuard guard;
+    if (event->signaled)
+    {
+        event->signaled = false;
+        return true;
+    }
+    ASSERT(co->tag.next == nullptr);
+    event->waiters.push_back(co->tag);
+    return false;
+}
+
+void Coroutines::sleep(Coroutine* co, uint32_t ticks)
+{
+    Timer::add_timer(&co->timer, ticks, 0);
+}
@@ -0,0 +1,93 @@
+#pragma once
+#include "kernel/list.h"
+#include "kernel/timer.h"
+#include "kernel/work_queue.h"
+#include "lib/stdint.h"
+
+struct Coroutine;
+
+//协程函数的返回值,由CO_宏返回
+enum class CoroutineStatus : uint32_t
+{
+    ready,    // 主动让出,立即重新排队
+    waiting,  // 等待事件或定时器,由它们重新排队
+    done      // 已结束
+};
+
+typedef CoroutineStatus (*CoroutineFunction_t)(Coroutine* co);
+
+//协程等待的事件,通知时没有等待者则记下,下一个等待者不再阻塞,因此不会丢失通知,可以在中断中通知
+struct CoroutineEvent
+{
+    List waiters;
+    bool signaled;
+};
+
+/* 无栈协程,由调用者分配,结束前不能释放.协程函数每次被恢复时从头调用,
+ * 由CO_BEGIN跳转到上次挂起的位置,因此局部变量不能跨越挂起点,状态需放在arg指向的结构中 */
+struct Coroutine
+{
+    Work                work;      // 在执行器线程中恢复运行的任务
+    ListElement         tag;       // 等待事件时所在的链表
+    KernelTimer         timer;     // CO_SLEEP使用的定时器
+    CoroutineFunction_t function;  // 协程函数
+    void*               arg;       // 协程的参数
+    uint32_t            line;      // 恢复时跳转到的行号,0表示从头开始
+    bool                done;      // 是否已结束
+};
+
+namespace Coroutines
+{
+    //创建执行器线程,所有协程都在这个线程中轮流运行
+    void init();
+    void init_event(CoroutineEvent* event);
+    void spawn(Coroutine* co, CoroutineFunction_t function, void* arg);
+    //唤醒一个或全部等待event的协程
+    void notify_one(CoroutineEvent* event);
+    void notify_all(CoroutineEvent* event);
+    //以下由CO_宏调用
+    bool wait(Coroutine* co, CoroutineEvent* event);
+    void sleep(Coroutine* co, uint32_t ticks);
+}  // namespace Coroutines
+
+//以下宏只能在协程函数中使用,且每行最多一个
+#define CO_BEGIN(co)              \
+    switch ((co)->line)           \
+    {                             \
+        case 0:
+#define CO_END(co)                \
+    }                             \
+    (co)->line = 0;               \
+    return CoroutineStatus::done;
+
+//让出执行器,排到其它就绪协程之后
+#define CO_YIELD(co)                   \
+    do                                 \
+    {                                  \
+        (co)->line = __LINE__;         \
+        return CoroutineStatus::ready; \
+        case __LINE__:;                \
+    } while (0)
+
+//挂起ticks个时钟嘀嗒
+#define CO_SLEEP(co, ticks)               \
+    do                                    \
+    {                                     \
+        (co)->line = __LINE__;            \
+        Coroutines::sleep((co), (ticks)); \
+        return CoroutineStatus::waiting;  \
+        case __LINE__:;                   \
+    } while (0)
+
+//condition不成立时等待event,被通知后重新检查condition
+#define CO_WAIT_UNTIL(co, event, condition)                                                             \
+    do                                                                                                  \
+    {                                                                                                   \
+        (co)->line = __LINE__;                                                                          \
+        [[fallthrough]];                                                                                \
+        case __LINE__:                                                                                  \
+        if (!(condition))                                                                               \
+        {                                                                                               \
+            return Coroutines::wait((co), (event)) ? CoroutineStatus::ready : CoroutineStatus::waiting; \
+        }                                                                                               \
+    } while (0)
@@ -0,0 +1,197 @@
+#include "kernel/fpu.h"
+#include "kernel/asm_interface.h"
+#include "kernel/memory.h"
+#include "lib/debug.h"
+#include "lib/macro.h"
+#include "lib/string.h"
+#include "thread/thread.h"
+
+#define CR0_MP (1 << 1)           // 置1后wait指令也受TS控制
+#define CR0_EM (1 << 2)           // 置1表示没有浮点单元,浮点指令触发#NM
+#define CR0_TS (1 << 3)           // 置1后第一条浮点指令触发#NM
+#define CR0_NE (1 << 5)           // 置1后x87的浮点异常通过#MF报告
+#define CR4_OSFXSR (1 << 9)       // 允许fxsave/fxrstor和SSE指令
+#define CR4_OSXMMEXCPT (1 << 10)  // SIMD浮点异常通过#XM报告
+#define CPUID_FPU (1 << 0)        // cpuid 1号功能edx的第0位表示有浮点单元
+#define CPUID_FXSR (1 << 24)      // 支持fxsave/fxrstor
+#define CPUID_SSE (1 << 25)       // 支持SSE
+
+bool     fpu_available;
+bool     fxsr_available;
+PCB*     fpu_owner;      // 状态正保存在浮点单元中的线程,为nullptr表示浮点单元中没有线程的状态
+FpuState initial_state;  // 初始化后的浮点状态,线程第一次使用浮点单元时从此恢复
+
+uint32_t read_cr0()
+{
+    uint32_t cr0;
+    asm volatile("movl %%cr0, %0" : "=r"(cr0));
+    return cr0;
+}
+
+void write_cr0(uint32_t cr0)
+{
+    asm volatile("movl %0, %%cr0" : : "r"(cr0) : "memory");
+}
+
+void set_ts()
+{
+    write_cr0(read_cr0() | CR0_TS);
+}
+
+void clear_ts()
+{
+    asm volatile("clts");
+}
+
+void save_state(FpuState* state)
+{
+    if (fxsr_available)
+    {
+        asm volatile("fxsave %0" : "=m"(*state));
+    }
+    else
+    {  // fnsave会重新初始化浮点单元,需要恢复
+        asm volatile("fnsave %0; frstor %0" : "=m"(*state) : : "memory");
+    }
+}
+
+void restore_state(FpuState* state)
+{
+    if (fxsr_available)
+    {
+        asm volatile("fxrstor %0" : : "m"(*state));
+    }
+    else
+    {
+        asm volatile("frstor %0" : : "m"(*state));
+    }
+}
+
+FpuState* alloc_state()
+{  // malloc_kernel不保证16字节对齐,多申请一些再对齐
+    uint32_t p = (uint32_t)Memory::malloc_kernel(sizeof(FpuState) + alignof(FpuState));
+    if (p == 0)
+    {
+        return nullptr;
+    }
+    return (FpuState*)((p + alignof(FpuState) - 1) & ~(alignof(FpuState) - 1));
+}
+
+/* #NM处理函数,把浮点单元交给当前线程 */
+void device_not_available_handler(uint32_t no)
+{
+    UNUSED(no);
+    PCB* pcb = Thread::get_current_pcb();
+    clear_ts();
+    if (fpu_owner == pcb)
+    {
+        return;
+    }
+    if (pcb->fpu_state == nullptr)
+    {
+        pcb->fpu_state = alloc_state();
+        if (pcb->fpu_state == nullptr)
+        {
+            PANIC("malloc fpu state failed");
+        }
+        memcpy(pcb->fpu_state, &initial_state, sizeof(FpuState));
+    }
+    if (fpu_owner != nullptr)
+    {
+        save_state(fpu_owner->fpu_state);
+    }
+    restore_state(pcb->fpu_state);
+    fpu_owner = pcb;
+}
+
+void FPU::init()
+{
+    printkln("fpu init start");
+    uint32_t eax, ebx, ecx, edx;
+    cpuid(1, &eax, &ebx, &ecx, &edx);
+    fpu_available = edx & CPUID_FPU;
+    if (!fpu_available)
+    {  //保持EM置位,浮点指令会触发#NM异常
+        printkln("fpu is not available");
+        return;
+    }
+    fxsr_available = edx & CPUID_FXSR;
+    write_cr0((read_cr0() & ~(CR0_EM | CR0_TS)) | CR0_MP | CR0_NE);
+    if (fxsr_available)
+    {
+        uint32_t cr4;
+        asm volatile("movl %%cr4, %0" : "=r"(cr4));
+        cr4 |= CR4_OSFXSR;
+        if (edx & CPUID_SSE)
+        {
+            cr4 |= CR4_OSXMMEXCPT;
+        }
+        asm volatile("movl %0, %%cr4" : : "r"(cr4));
+    }
+    asm volatile("fninit");
+    save_state(&initial_state);
+    fpu_owner = nullptr;
+    set_ts();
+    Interrupt::register_interrupt_handler(0x07, (InterruptHandler)device_not_available_handler);
+    printkln("fpu init done");
+}
+
+void FPU::switch_to(PCB* next)
+{
+    if (!fpu_available)
+    {
+        return;
+    }
+    if (next == fpu_owner)
+    {
+        clear_ts();
+    }
+    else
+    {
+        set_ts();
+    }
+}
+
+void FPU::release(PCB* pcb)
+{
+    if (fpu_owner == pcb)
+    {
+        fpu_owner = nullptr;
+    }
+}
+
+void FPU::init_fork(PCB* child, PCB* parent)
+{
+    AtomicGuard guard;
+    if (parent->fpu_state == nullptr)
+    {
+        return;
+    }
+    child->fpu_state = alloc_state();
+    ASSERT(child->fpu_state != nullptr);
+    if (fpu_owner == parent)
+    {  //父进程的最新状态还在浮点单元中
+        save_state(child->fpu_state);
+    }
+    else
+    {
+        memcpy(child->fpu_state, parent->fpu_state, sizeof(FpuState));
+    }
+}
+
+KernelFpuGuard::KernelFpuGuard()
+{
+    ASSERT(fpu_available);
+    clear_ts();
+    if (fpu_owner != nullptr)
+    {  //先保存线程的状态,离开作用域后由#NM恢复
+        save_state(fpu_owner->fpu_state);
+        fpu_owner = nullptr;
+    }
+    restore_state(&initial_state);
+}
+
+KernelFpuGuard::~KernelFpuGuard()
+{
+    set_ts();
+}
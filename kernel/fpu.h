@@ -0,0 +1,36 @@
+#pragma once
+#include "kernel/interrupt.h"
+#include "lib/stdint.h"
+
+struct PCB;
+
+//fxsave保存的浮点和SSE寄存器,不支持fxsave时用fnsave保存前108字节
+struct alignas(16) FpuState
+{
+    uint8_t data[512];
+};
+
+/* 浮点单元的惰性切换:切换线程时只设置cr0.TS,
+ * 线程第一次使用浮点指令时触发#NM,再保存上一个使用者的状态并恢复自己的状态,
+ * 从不使用浮点单元的线程在切换时没有额外开销 */
+namespace FPU
+{
+    void init();
+    //切换到next前调用,next的状态不在浮点单元中时设置TS
+    void switch_to(PCB* next);
+    //线程结束时调用,放弃它在浮点单元中的状态
+    void release(PCB* pcb);
+    //fork时复制父进程的浮点状态
+    void init_fork(PCB* child, PCB* parent);
+}  // namespace FPU
+
+//在内核中使用浮点或SIMD指令时在作用域内持有,期间关中断,不会破坏线程的浮点状态
+class KernelFpuGuard
+{
+public:
+    KernelFpuGuard();
+    ~KernelFpuGuard();
+
+private:
+    AtomicGuard guard;
+};
@@ -0,0 +1,125 @@
+#include "kernel/futex.h"
+#include "kernel/interrupt.h"
+#include "kernel/memory.h"
+#include "kernel/timer.h"
+#include "lib/debug.h"
+#include "lib/stdio.h"
+#include "thread/sync.h"
+#include "thread/thread.h"
+
+//在futex上等待的线程,放在等待线程的内核栈上
+struct FutexWaiter
+{
+    ListElement tag;  // 所在哈希槽的标记,被唤醒或超时后移出
+    uint32_t    key;  // futex的物理地址
+    WaitQueue   queue;
+};
+
+List futex_table[FUTEX_HASH_SIZE];
+
+void Futex::init()
+{
+    printkln("futex init start");
+    for (auto& list : futex_table)
+    {
+        list.init();
+    }
+    printkln("futex init done");
+}
+
+//必须是当前进程已分配的用户内存,否则读取时会访问内核内存或在缺页中断中停机
+bool is_futex_address_valid(volatile uint32_t* address)
+{
+    return ((uint32_t)address & 3) == 0 &&
+           Memory::is_user_range_allocated(Thread::get_current_pcb(), (uint32_t)address, sizeof(uint32_t));
+}
+
+uint32_t get_futex_key(volatile uint32_t* address)
+{
+    return (uint32_t)Memory::get_phsical_address_by_virtual_address((void*)address);
+}
+
+List& get_futex_list(uint32_t key)
+{
+    return futex_table[((key >> 2) ^ (key >> 12)) % FUTEX_HASH_SIZE];
+}
+
+int32_t Futex::wait(volatile uint32_t* address, uint32_t expected, uint32_t msecond)
+{
+    if (!is_futex_address_valid(address))
+    {
+        return -1;
+    }
+    AtomicGuard guard;  //比较和进入等待之间不能被唤醒者插入
+    if (*address != expected)
+    {  //读取时缺页会先分配实页
+        return -1;
+    }
+    if (!Memory::unshare_user_page((uint32_t)address))
+    {  //合并页被写时会换成新的实页,等待前先分离,否则key会变化,也会与其他进程共享
+        return -1;
+    }
+    FutexWaiter waiter;
+    waiter.key = get_futex_key(address);
+    get_futex_list(waiter.key).push_back(waiter.tag);
+    bool woken = waiter.queue.wait(msecond == 0 ? 0 : Timer::msecond_to_ticks(msecond));
+    if (waiter.tag.next != nullptr)
+    {  //超时,仍在哈希槽中
+        waiter.tag.remove_from_list();
+    }
+    return woken ? 0 : -1;
+}
+
+bool match_futex_waiter(ListElement* element, void* arg)
+{
+    return ((FutexWaiter*)element)->key == *(uint32_t*)arg;  // tag是FutexWaiter的第一个成员
+}
+
+int32_t Futex::wake(volatile uint32_t* address, uint32_t count)
+{
+    if (!is_futex_address_valid(address))
+    {
+        return -1;
+    }
+    AtomicGuard guard;
+    if (!Memory::is_page_present((void*)address))
+    {  //没有实页时不会有线程在等待
+        return 0;
+    }
+    uint32_t key   = get_futex_key(address);
+    List&    list  = get_futex_list(key);
+    int32_t  woken = 0;
+    while ((uint32_t)woken < count)
+    {
+        FutexWaiter* waiter = (FutexWaiter*)list.for_each(match_futex_waiter, &key);
+        if (waiter == nullptr)
+        {
+            break;
+        }
+        waiter->tag.remove_from_list();
+        if (waiter->queue.wake_one())
+        {  //已超时的等待者不计数
+            woken++;
+        }
+    }
+    return woken;
+}
+
+bool match_futex_frame(ListElement* element, void* arg)
+{
+    return (((FutexWaiter*)element)->key & 0xfffff000) == *(uint32_t*)arg;
+}
+
+bool Futex::has_waiters(uint32_t frame)
+{
+    AtomicGuard guard;
+    //同一页内的地址可能落在不同的哈希槽中,需要查找所有的槽
+    for (auto& list : futex_table)
+    {
+        if (list.for_each(match_futex_frame, &frame) != nullptr)
+        {
+            return true;
+        }
+    }
+    return false;
+}
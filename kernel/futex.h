@@ -0,0 +1,19 @@
+#pragma once
+#include "lib/stdint.h"
+
+#define FUTEX_HASH_SIZE 64  // 等待队列哈希表的槽数
+
+#define FUTEX_WAKE_ALL 0xffffffffU  // 唤醒所有等待者
+
+/* 用户态锁的等待和唤醒,以物理地址区分不同的futex,
+ * 多个虚拟地址映射到同一实页时(如共享内存)等待和唤醒的是同一个futex */
+namespace Futex
+{
+    void init();
+    //*address等于expected时阻塞,msecond为0表示一直等待;被唤醒返回0,值不相等、超时或地址错误返回-1
+    int32_t wait(volatile uint32_t* address, uint32_t expected, uint32_t msecond);
+    //唤醒最多count个等待address的线程,返回唤醒的个数
+    int32_t wake(volatile uint32_t* address, uint32_t count);
+    //实页frame中是否有futex的等待者,同页合并不能移动这样的页,否则唤醒时物理地址对不上
+    bool has_waiters(uint32_t frame);
+}  // namespace Futex
@@ -3,10 +3,16 @@
 #include "disk/file_system.h"
 #include "disk/ide.h"
 #include "kernel/asm_interface.h"
+#include "kernel/clock.h"
+#include "kernel/coroutine.h"
+#include "kernel/fpu.h"
+#include "kernel/futex.h"
 #include "kernel/interrupt.h"
 #include "kernel/keyboard.h"
 #include "kernel/memory.h"
 #include "kernel/timer.h"
+#include "kernel/vdso.h"
+#include "kernel/work_queue.h"
 #include "lib/stdio.h"
 #include "lib/syscall.h"
 #include "process/tss.h"
@@ -18,8 +24,15 @@ void init_all()
     //初始化中断
     Interrupt::init();
     Timer::init();
+    Clock::init();
     Memory::init();
+    Vdso::init();
     Thread::init();
+    FPU::init();
+    Futex::init();
+    WorkQueue::init_irq_queue();
+    Coroutines::init();
+    Memory::init_page_merge();
     TSS::init();
     Systemcall::init();
     Keyboard::init();
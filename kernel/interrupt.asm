@@ -3,6 +3,10 @@
 %define ZERO push 0		 ; 若在相关的异常中cpu没有压入错误码,为了统一栈中格式,就手工压入一个0
 
 extern idt_table		 ;idt_table是C中注册的中断处理程序数组
+extern interrupt_enter		 ;以下函数用于统计cpu时间、中断返回前的调度和修正系统调用的返回值
+extern interrupt_exit
+extern syscall_enter
+extern syscall_exit
 
 section .data
 global interrupt_entry_table
@@ -20,13 +24,20 @@ intr%1entry:		 ; 每个中断处理程序都要压入中断向量号,所以一
    push gs
    pushad			 ; PUSHAD指令压入32位寄存器,其入栈顺序是: EAX,ECX,EDX,EBX,ESP,EBP,ESI,EDI
 
+   push %1			 ; 不管idt_table中的目标程序是否需要参数,都一律压入中断向量号,调试时很方便
+   push %1
+   call interrupt_enter          ; 开始统计中断处理的时间
+   add esp, 4
+   call [idt_table + %1*4]       ; 调用idt_table中的C版本中断处理函数
+
+%if %1 >= 0x20
+   ; 处理函数执行完后才发送EOI,期间8259A不会再送来同级和更低级的中断;异常不是8259A送来的,不发送
+   ; 要在interrupt_exit切换线程之前发送,否则要等被中断的线程再次运行时才能收到中断
    ; 如果是从片上进入的中断,除了往从片上发送EOI外,还要往主片上发送EOI 
    mov al,0x20                   ; 中断结束命令EOI
    out 0xa0,al                   ; 向从片发送
    out 0x20,al                   ; 向主片发送
-
-   push %1			 ; 不管idt_table中的目标程序是否需要参数,都一律压入中断向量号,调试时很方便
-   call [idt_table + %1*4]       ; 调用idt_table中的C版本中断处理函数
+%endif
    jmp intr_exit
 
 section .data
@@ -36,6 +47,9 @@ section .data
 section .text
 global intr_exit
 intr_exit:	     
+   push esp			   ; 参数为栈中的中断上下文
+   call interrupt_exit             ; 需要调度时在此切换线程,中断处理函数本身不切换
+   add esp, 4
 ; 以下是恢复上下文环境
    add esp, 4			   ; 跳过中断号
    popad
@@ -112,6 +126,10 @@ syscall_handler:
 				    ; EAX,ECX,EDX,EBX,ESP,EBP,ESI,EDI 
 				 
    push 0x80			    ; 此位置压入0x80也是为了保持统一的栈格式
+   call syscall_enter		    ; 开始统计系统调用的时间,会破坏eax,ecx,edx
+   mov eax, [esp + 8*4]		    ; 从pushad保存的位置恢复
+   mov ecx, [esp + 7*4]
+   mov edx, [esp + 6*4]
 
 ;2 为系统调用子功能传入参数
    push edx			    ; 系统调用中第3个参数
@@ -121,8 +139,61 @@ syscall_handler:
 ;3 调用子功能处理函数
    call [syscall_table + eax*4]	    ; 编译器会在栈中根据C函数声明匹配正确数量的参数
    add esp, 12			    ; 跨过上面的三个参数
+   push eax
+   call syscall_exit		    ; 内核访问用户内存超出内存限制时返回值改为-1
+   add esp, 4
 
 ;4 将call调用后的返回值存入待当前内核栈中eax的位置
    mov [esp + 8*4], eax	
    jmp intr_exit		    ; intr_exit返回,恢复上下文
 
+;;;;;;;;;;;;;;;;   sysenter入口   ;;;;;;;;;;;;;;;;
+; 用户态的调用约定: eax为子功能号,ebx,ecx,edx为参数,edi为返回地址,ebp为用户栈
+; 在内核栈中构造与0x80号中断相同的栈结构,fork和中断返回都可以照常使用
+SELECTOR_SYSEXIT_CS equ (9<<3) + 3
+SELECTOR_SYSEXIT_SS equ (10<<3) + 3
+global sysenter_handler
+sysenter_handler:
+   mov esp, [esp]		    ; SYSENTER_ESP指向tss的esp0字段,从中取出当前线程的内核栈
+   push SELECTOR_SYSEXIT_SS
+   push ebp			    ; 用户栈
+   pushfd
+   or dword [esp], 0x200	    ; sysenter会关中断,返回用户态后中断是打开的
+   push SELECTOR_SYSEXIT_CS
+   push edi			    ; 返回地址
+   push 0			    ; 压入0作为error_code
+   push ds			    ; 不重新加载段寄存器,用户的数据段也是平坦模型
+   push es
+   push fs
+   push gs
+   pushad
+   push 0x80
+
+   call syscall_enter
+   mov eax, [esp + 8*4]
+   mov ecx, [esp + 7*4]
+   mov edx, [esp + 6*4]
+   push edx
+   push ecx
+   push ebx
+   call [syscall_table + eax*4]
+   add esp, 12
+   push eax
+   call syscall_exit
+   add esp, 4
+   mov [esp + 8*4], eax
+
+   push esp
+   call interrupt_exit
+   add esp, 4
+   add esp, 4			    ; 跳过中断号
+   popad
+   pop gs
+   pop fs
+   pop es
+   pop ds
+   add esp, 4			    ; 跳过error_code
+   mov edx, [esp]		    ; sysexit返回到edx,用户栈为ecx,从栈中取出,线程可能已修改过它们
+   mov ecx, [esp + 12]
+   sti				    ; sti在下一条指令执行后才生效,sysexit之前不会响应中断
+   sysexit
@@ -20,6 +20,10 @@ extern "C" {
 extern uint32_t syscall_handler(uint32_t);
 //  参考interrupt.asm
 extern InterruptHandler interrupt_entry_table[IDT_DESC_CNT];
+void                    interrupt_enter(uint32_t no);
+void                    syscall_enter();
+int32_t                 syscall_exit(int32_t result);
+void                    interrupt_exit(InterruptStack* stack);
 };
 
 // 中断门描述符结构体,x86固定结构
@@ -168,6 +172,12 @@ void Interrupt::register_interrupt_handler(uint8_t no, InterruptHandler function
     idt_table[no] = function;
 }
 
+void Interrupt::set_task_gate(uint8_t no, uint16_t selector)
+{
+    idt[no]          = GateDescript(IDT_DESC_ATTR_TASK, nullptr);
+    idt[no].selector = selector;
+}
+
 bool Interrupt::is_enabled()
 {
     return get_status() == InterruptStatus::on;
@@ -200,4 +210,42 @@ AtomicGuard::AtomicGuard()
 AtomicGuard::~AtomicGuard()
 {
     Interrupt::set_status(old_status);
+    if (old_status == InterruptStatus::on)
+    {  //临界区中唤醒了更高优先级的线程时立即切换
+        Thread::preempt();
+    }
+}
+
+//以下在interrupt.asm中调用,用于统计线程的cpu时间和在中断返回前调度
+void interrupt_enter(uint32_t no)
+{
+    bool is_irq = no >= 0x20 && no < 0x30;
+    Thread::account_time(is_irq ? CpuTimeType::irq : CpuTimeType::kernel);
+}
+
+void syscall_enter()
+{
+    Thread::account_time(CpuTimeType::kernel);
+    Thread::get_current_pcb()->memory_fault = false;
+}
+
+//内核访问用户内存时超出内存限制,系统调用返回-1
+int32_t syscall_exit(int32_t result)
+{
+    return Thread::get_current_pcb()->memory_fault ? -1 : result;
+}
+
+//中断返回前的抢占点,被中断的代码关中断时不能切换线程
+void interrupt_exit(InterruptStack* stack)
+{
+    if ((stack->cs & 3) == 3 && Thread::get_current_pcb()->process->killed)
+    {  //进程已被结束,线程不再返回用户态
+        Thread::exit_current_thread();
+    }
+    if (stack->eflags & EFLAGS_IF)
+    {
+        Thread::account_time(CpuTimeType::kernel);
+        Thread::preempt();
+    }
+    Thread::account_time((stack->cs & 3) == 3 ? CpuTimeType::user : CpuTimeType::kernel);
 }
\ No newline at end of file
@@ -61,4 +61,6 @@ namespace Interrupt
     void            register_interrupt_handler(uint8_t no, InterruptHandler function);
     bool            is_enabled();
     bool            is_disabled();
+    //把no号中断改为任务门,发生时cpu切换到selector指向的tss,用于原来的栈已不可用的双重错误
+    void set_task_gate(uint8_t no, uint16_t selector);
 };  // namespace Interrupt
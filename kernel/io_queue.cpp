@@ -31,10 +31,11 @@ uint8_t IOQueue::pop_front()
     AtomicGuard guard;
     while (is_empty())
     {
-        Thread::yield();
+        readers.wait();
     }
     uint8_t byte = buff[tail];
     tail         = get_next_position(tail);
+    writers.wake_one();
     return byte;
 }
 
@@ -42,11 +43,12 @@ void IOQueue::push_back(uint8_t byte)
 {
     AtomicGuard guard;
     while (is_full())
-    {
-        Thread::yield();
+    {  //中断中不能阻塞,调用前需先确认队列未满
+        writers.wait();
     }
     buff[head] = byte;
     head       = get_next_position(head);
+    readers.wake_one();
 }
 
 uint32_t IOQueue::get_length()
@@ -16,7 +16,9 @@ public:
     bool     is_empty();
 
 private:
-    uint8_t  buff[IO_QUEUE_BUFF_SIZE];  // 缓冲区大小
-    uint32_t head;                      // 队首,数据往队首处写入
-    uint32_t tail;                      // 队尾,数据从队尾处读出
+    uint8_t   buff[IO_QUEUE_BUFF_SIZE];  // 缓冲区大小
+    uint32_t  head;                      // 队首,数据往队首处写入
+    uint32_t  tail;                      // 队尾,数据从队尾处读出
+    WaitQueue readers;                   // 队列空时等待的读者
+    WaitQueue writers;                   // 队列满时等待的写者
 };
@@ -0,0 +1,129 @@
+#include "kernel/io_ring.h"
+#include "disk/file_system.h"
+#include "kernel/memory.h"
+#include "lib/debug.h"
+#include "lib/string.h"
+#include "thread/thread.h"
+
+#define barrier() asm volatile("" : : : "memory")
+
+//队列的位置由环形队列的地址和内核保存的项数算出,不使用用户可以改写的ring->sqes和ring->cqes
+IoRingSqe* get_sqes(IoRing* ring)
+{
+    return (IoRingSqe*)((uint32_t)ring + sizeof(IoRing));
+}
+
+IoRingCqe* get_cqes(IoRing* ring, uint32_t entries)
+{
+    return (IoRingCqe*)((uint32_t)get_sqes(ring) + entries * sizeof(IoRingSqe));
+}
+
+IoRing* Ring::setup(uint32_t entries)
+{
+    PCB* pcb = Thread::get_current_pcb();
+    if (!Thread::is_user_thread(pcb) || pcb->io_ring != nullptr || entries == 0 || entries > IO_RING_MAX_ENTRIES)
+    {
+        return nullptr;
+    }
+    uint32_t size = 1;
+    while (size < entries)
+    {
+        size <<= 1;
+    }
+    IoRing* ring = (IoRing*)Memory::malloc_user_page(1);
+    if (ring == nullptr)
+    {
+        return nullptr;
+    }
+    memset(ring, 0, PAGE_SIZE);
+    ring->entries        = size;
+    ring->sqes           = get_sqes(ring);
+    ring->cqes           = get_cqes(ring, size);
+    pcb->io_ring         = ring;
+    pcb->io_ring_entries = size;
+    return ring;
+}
+
+int32_t execute_sqe(IoRingSqe* sqe)
+{
+    switch (sqe->op)
+    {
+        case IoRingOp::nop: return 0;
+        case IoRingOp::read: return FileSystem::read(sqe->fd, (void*)sqe->addr, sqe->length);
+        case IoRingOp::write: return FileSystem::write(sqe->fd, (const void*)sqe->addr, sqe->length);
+        case IoRingOp::open: return FileSystem::open((const char*)sqe->addr, (uint8_t)sqe->length);
+        case IoRingOp::pipe: return FileSystem::pipe((int32_t*)sqe->addr);
+        default: return -1;
+    }
+}
+
+int32_t Ring::enter(uint32_t to_submit)
+{
+    PCB*    pcb  = Thread::get_current_pcb();
+    IoRing* ring = pcb->io_ring;
+    if (ring == nullptr)
+    {
+        return -1;
+    }
+    //只有sq_tail和cq_head由用户进程写入,其余都以内核保存的项数为准,下标取模后不会越界
+    uint32_t   entries   = pcb->io_ring_entries;
+    uint32_t   mask      = entries - 1;
+    IoRingSqe* sqes      = get_sqes(ring);
+    IoRingCqe* cqes      = get_cqes(ring, entries);
+    uint32_t   submitted = 0;
+    if (ring->sq_tail - ring->sq_head > entries)
+    {
+        return -1;
+    }
+    while (submitted < to_submit && ring->sq_head != ring->sq_tail)
+    {
+        barrier();
+        //先复制提交项,防止执行期间被用户进程修改
+        IoRingSqe sqe = sqes[ring->sq_head & mask];
+        ring->sq_head++;
+        int32_t result = execute_sqe(&sqe);
+        if (ring->cq_tail - ring->cq_head < entries)
+        {
+            IoRingCqe* cqe = &cqes[ring->cq_tail & mask];
+            cqe->user_data = sqe.user_data;
+            cqe->result    = result;
+            barrier();
+            ring->cq_tail++;
+        }
+        else
+        {
+            ring->dropped++;
+        }
+        submitted++;
+    }
+    return submitted;
+}
+
+IoRingSqe* io_ring_get_sqe(IoRing* ring)
+{
+    if (ring->sq_tail - ring->sq_head >= ring->entries)
+    {
+        return nullptr;
+    }
+    IoRingSqe* sqe = &ring->sqes[ring->sq_tail & (ring->entries - 1)];
+    memset(sqe, 0, sizeof(IoRingSqe));
+    return sqe;
+}
+
+void io_ring_advance_sq(IoRing* ring)
+{
+    barrier();  //提交项写完后才能让内核看到
+    ring->sq_tail++;
+}
+
+bool io_ring_pop_cqe(IoRing* ring, IoRingCqe* cqe)
+{
+    if (ring->cq_head == ring->cq_tail)
+    {
+        return false;
+    }
+    barrier();
+    *cqe = ring->cqes[ring->cq_head & (ring->entries - 1)];
+    ring->cq_head++;
+    return true;
+}
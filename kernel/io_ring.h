@@ -0,0 +1,61 @@
+#pragma once
+#include "lib/stdint.h"
+
+#define IO_RING_MAX_ENTRIES 128  // 提交队列和完成队列放在同一页中,最多128项
+
+//提交的操作类型
+enum class IoRingOp : uint8_t
+{
+    nop,
+    read,   // fd, addr为缓冲区, length为字节数
+    write,  // fd, addr为缓冲区, length为字节数
+    open,   // addr为路径, length为打开选项
+    pipe    // addr为int32_t[2]
+};
+
+//提交队列项,由用户进程填写
+struct IoRingSqe
+{
+    IoRingOp op;
+    uint8_t  reserved[3];
+    int32_t  fd;
+    uint32_t addr;
+    uint32_t length;
+    uint32_t user_data;  // 原样放入完成队列项,用于区分请求
+};
+
+//完成队列项,由内核填写
+struct IoRingCqe
+{
+    uint32_t user_data;
+    int32_t  result;  // 与对应系统调用的返回值相同
+};
+
+/* 映射在用户进程中的一对环形队列,
+ * 用户进程写sq_tail和cq_head,内核写sq_head和cq_tail,下标只增不减,用时对entries取模 */
+struct IoRing
+{
+    volatile uint32_t sq_head;
+    volatile uint32_t sq_tail;
+    volatile uint32_t cq_head;
+    volatile uint32_t cq_tail;
+    uint32_t          entries;  // 2的幂
+    uint32_t          dropped;  // 完成队列满时丢弃的完成项数
+    IoRingSqe*        sqes;
+    IoRingCqe*        cqes;
+};
+
+namespace Ring
+{
+    //为当前进程创建环形队列,entries会向上取整到2的幂,失败时返回nullptr
+    IoRing* setup(uint32_t entries);
+    //依次同步执行最多to_submit个提交项,返回执行的个数
+    int32_t enter(uint32_t to_submit);
+}  // namespace Ring
+
+//以下在用户态使用
+//取得一个空闲的提交项,队列满时返回nullptr,填写后调用io_ring_advance_sq提交
+IoRingSqe* io_ring_get_sqe(IoRing* ring);
+void       io_ring_advance_sq(IoRing* ring);
+//取出一个完成项,没有时返回false
+bool io_ring_pop_cqe(IoRing* ring, IoRingCqe* cqe);
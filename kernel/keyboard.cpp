@@ -3,6 +3,8 @@
 #include "kernel/interrupt.h"
 #include "kernel/io_queue.h"
 #include "kernel/keyboard.h"
+#include "kernel/work_queue.h"
+#include "lib/macro.h"
 #include "lib/stdio.h"
 #include "thread/thread.h"
 
@@ -37,6 +39,8 @@
 #define caps_lock_make 0x3a
 
 IOQueue keyboard_buffer;  // 定义键盘缓冲区
+IOQueue scancode_buffer;  // 中断中读出的扫描码,由工作线程转换为字符
+Work    keyboard_work;
 
 /* 定义以下变量记录相应键是否按下的状态,
  * ext_scancode用于记录makecode是否以0xe0开头 */
@@ -108,16 +112,15 @@ char keymap[][2] = {
     /*其它按键暂不处理*/
 };
 
-/* 键盘中断处理程序 */
-void interrupt_keyboard_handler(void)
+//在工作线程中把扫描码转换为字符放入键盘缓冲区
+void process_scancode(uint16_t scancode)
 {
     /* 这次中断发生前的上一次中断,以下任意三个键是否有按下 */
     bool ctrl_down_last  = ctrl_status;
     bool shift_down_last = shift_status;
     bool caps_lock_last  = caps_lock_status;
 
-    bool     break_code;
-    uint16_t scancode = inb(KBD_BUF_PORT);
+    bool break_code;
 
     /* 若扫描码是e0开头的,表示此键的按下将产生多个扫描码,
      * 所以马上结束此次中断处理函数,等待下一个扫描码进来*/
@@ -251,11 +254,33 @@ void interrupt_keyboard_handler(void)
     }
 }
 
+void keyboard_work_handler(void* arg)
+{
+    UNUSED(arg);
+    while (!scancode_buffer.is_empty())
+    {
+        process_scancode(scancode_buffer.pop_front());
+    }
+}
+
+/* 键盘中断处理程序,只读出扫描码,转换交给工作线程 */
+void interrupt_keyboard_handler(void)
+{
+    uint8_t scancode = inb(KBD_BUF_PORT);
+    if (!scancode_buffer.is_full())
+    {
+        scancode_buffer.push_back(scancode);
+    }
+    WorkQueue::get_irq_queue()->queue(&keyboard_work);
+}
+
 /* 键盘初始化 */
 void Keyboard::init()
 {
     printkln("keyboard init start");
     keyboard_buffer = IOQueue();
+    scancode_buffer = IOQueue();
+    WorkQueue::init_work(&keyboard_work, keyboard_work_handler, nullptr);
     Interrupt::register_interrupt_handler(0x21, (InterruptHandler)interrupt_keyboard_handler);
     printkln("keyboard init done");
 }
@@ -263,16 +288,9 @@ void Keyboard::init()
 char Keyboard::read_key(bool block)
 {
     AtomicGuard guard;
-    while (keyboard_buffer.is_empty())
+    if (!block && keyboard_buffer.is_empty())
     {
-        if (block)
-        {
-            Thread::yield();
-        }
-        else
-        {
-            return -1;
-        }
+        return -1;
     }
-    return (char)keyboard_buffer.pop_front();
+    return (char)keyboard_buffer.pop_front();  //缓冲区为空时阻塞,直到键盘中断写入
 }
\ No newline at end of file
@@ -147,7 +147,7 @@ p_mode_start:
 ; -------------------------   加载kernel  ----------------------
    mov eax, KERNEL_START_SECTOR        ; kernel.bin所在的扇区号
    mov ebx, KERNEL_BIN_BASE_ADDR       ; 从磁盘读出后，写入到ebx指定的地址
-   mov ecx, 200			       ; 读入的扇区数
+   mov ecx, 250			       ; 读入的扇区数
 
    call rd_disk_m_32
 
@@ -1,11 +1,14 @@
 #include "kernel/memory.h"
 #include "kernel/asm_interface.h"
+#include "kernel/futex.h"
 #include "kernel/interrupt.h"
+#include "kernel/timer.h"
 #include "lib/debug.h"
 #include "lib/macro.h"
 #include "lib/math.h"
 #include "lib/string.h"
 #include "process/process.h"
+#include "process/resource.h"
 #include "thread/sync.h"
 #include "thread/thread.h"
 /***************  位图地址 ********************
@@ -29,6 +32,12 @@
 
 #define DESC_CNT 7  // 内存块描述符个数
 
+#define FAULT_AROUND_PAGES 8  // 顺序访问的内存缺页时,连同之后的页一次映射的页数
+
+#define PAGE_MERGE_INTERVAL 1000  // 同页合并两次扫描之间的间隔,单位毫秒
+#define PAGE_MERGE_TABLE_PAGES 4  // 同页合并的哈希表占用的页数
+#define CR0_WP (1 << 16)          // cr0的WP位,置1后内核写只读页也会触发缺页中断
+
 //物理内存池
 struct PhysicalAddressPool
 {
@@ -65,6 +74,12 @@ struct Area
 
 typedef ListElement MemoryBlock;
 
+//用户实页的引用计数,下标与用户物理内存池的位图一致
+uint16_t* user_frame_reference;
+
+//同页合并的状态
+PageMergeState page_merge_state;
+
 void init_memory_pool(uint32_t total_memory)
 {
     uint32_t page_table_size = PAGE_SIZE * 256;             // 256个页表
@@ -125,6 +140,8 @@ void Memory::init_block_descript(MemoryBlockDescript* descript)
     }
 }
 
+void page_fault_handler(uint32_t no);
+
 void Memory::init()
 {
     printkln("memory init start");
@@ -134,6 +151,9 @@ void Memory::init()
     uint32_t memory_bytes_total = (*(uint32_t*)(0xb00));
     init_memory_pool(memory_bytes_total);
     init_block_descript(memory_block_decript);
+    Interrupt::register_interrupt_handler(0x0e, (InterruptHandler)page_fault_handler);  //缺页中断
+    //内核写合并后的只读用户页时也要触发缺页中断,才能在写之前复制出私有的实页
+    asm volatile("movl %%cr0, %%eax; orl %0, %%eax; movl %%eax, %%cr0" : : "i"(CR0_WP) : "eax", "memory");
     printkln("memory init done");
 }
 
@@ -183,9 +203,54 @@ void* malloc_one_user_physical_page()
     }
     ASSERT(!user_memory_pool.physical_address_pool.bitmap.test(index));
     user_memory_pool.physical_address_pool.bitmap.set(index, true);
+    user_frame_reference[index] = 1;
     return (uint8_t*)user_memory_pool.physical_address_pool.start_address + index * PAGE_SIZE;
 }
 
+//实页是否属于用户内存池
+bool is_user_frame(uint32_t paddr)
+{
+    uint32_t start = (uint32_t)user_memory_pool.physical_address_pool.start_address;
+    return start <= paddr && paddr < start + user_memory_pool.physical_address_pool.size;
+}
+
+//用户实页在用户内存池中的下标
+uint32_t get_user_frame_index(uint32_t paddr)
+{
+    ASSERT(is_user_frame(paddr));
+    return (paddr - (uint32_t)user_memory_pool.physical_address_pool.start_address) / PAGE_SIZE;
+}
+
+//增加用户实页的引用计数,只有同页合并会让多个虚页共享一个实页
+void get_user_frame(uint32_t paddr)
+{
+    uint32_t index = get_user_frame_index(paddr);
+    ASSERT(user_frame_reference[index] > 0);
+    if (user_frame_reference[index]++ == 1)
+    {
+        page_merge_state.pages_shared++;
+    }
+    page_merge_state.pages_saved++;
+}
+
+//减少用户实页的引用计数,计数为0时归还到用户内存池
+void put_user_frame(uint32_t paddr)
+{
+    uint32_t index = get_user_frame_index(paddr);
+    ASSERT(user_frame_reference[index] > 0);
+    ASSERT(user_memory_pool.physical_address_pool.bitmap.test(index));
+    if (--user_frame_reference[index] == 0)
+    {
+        user_memory_pool.physical_address_pool.bitmap.set(index, false);
+        return;
+    }
+    if (user_frame_reference[index] == 1)
+    {
+        page_merge_state.pages_shared--;
+    }
+    page_merge_state.pages_saved--;
+}
+
 bool is_pde_exist(uint32_t* pde)
 {
     return *pde & PG_P_1;
@@ -225,7 +290,22 @@ void* get_pde_pointer(void* virtual_address)
     return pde_virtual_addr;
 }
 
-void map_page(void* physical_page_address, void* virtual_page_address)
+//刷新tlb
+void flush_tlb()
+{
+    // asm volatile("invlpg %0" ::"m"(*(char*)virtual_page_address) : "memory");  //更新tlb
+    Process::activate_page_directory(Thread::get_current_pcb());  //更新tlb,i386不支持invlpg
+}
+
+//虚地址所在的页是否已映射到实页,pde不存在时不能访问pte
+bool Memory::is_page_present(void* virtual_address)
+{
+    return is_pde_exist((uint32_t*)get_pde_pointer(virtual_address)) &&
+           is_pte_exist((uint32_t*)get_pte_pointer(virtual_address));
+}
+
+//填写页表项但不刷新tlb,批量映射时由调用者统一刷新
+void install_page(void* physical_page_address, void* virtual_page_address)
 {
     // LOG_LINE();
     // printkln("%x %x", physical_page_address, virtual_page_address);
@@ -247,8 +327,12 @@ void map_page(void* physical_page_address, void* virtual_page_address)
         //创建pte
         *pte = (uint32_t)physical_page_address | PG_US_U | PG_RW_W | PG_P_1;
     }
-    // asm volatile("invlpg %0" ::"m"(*(char*)virtual_page_address) : "memory");  //更新tlb
-    Process::activate_page_directory(Thread::get_current_pcb());  //更新tlb,i386不支持invlpg
+}
+
+void map_page(void* physical_page_address, void* virtual_page_address)
+{
+    install_page(physical_page_address, virtual_page_address);
+    flush_tlb();
 }
 
 void* Memory::malloc_user_page(uint32_t count)
@@ -256,10 +340,16 @@ void* Memory::malloc_user_page(uint32_t count)
     AtomicGuard guard;
     PCB*        pcb = Thread::get_current_pcb();
     ASSERT(Thread::is_pcb_valid(pcb));
+    if (!Resource::charge(pcb, ResourceType::memory, count))
+    {
+        printkln("pid %d exceeds memory limit", pcb->pid);
+        return nullptr;
+    }
     void* virutal_page = malloc_user_virutal_page(pcb, count);
     if (virutal_page == nullptr)
     {
         printkln("virutal_page is nullptr");
+        Resource::uncharge(pcb, ResourceType::memory, count);
         return nullptr;
     }
     for (uint32_t i = 0; i < count; i++)
@@ -268,6 +358,7 @@ void* Memory::malloc_user_page(uint32_t count)
         if (physical_page == nullptr)
         {
             printkln("malloc one user physical page failed\n");
+            Resource::uncharge(pcb, ResourceType::memory, count - i);
             return nullptr;
         }
         map_page(physical_page, (void*)(((uint32_t)virutal_page) + PAGE_SIZE * i));
@@ -297,6 +388,27 @@ void* Memory::malloc_kernel_page(uint32_t count)
     return virutal_page;
 }
 
+void* Memory::malloc_kernel_stack(uint32_t count)
+{
+    AtomicGuard guard;
+    uint8_t*    guard_page = (uint8_t*)malloc_kernel_virutal_page(count + 1);
+    if (guard_page == nullptr)
+    {
+        return nullptr;
+    }
+    for (uint32_t i = 1; i <= count; i++)
+    {
+        void* physical_page = malloc_one_kernel_physical_page();
+        if (physical_page == nullptr)
+        {
+            printkln("malloc kernel stack failed");
+            return nullptr;
+        }
+        map_page(physical_page, guard_page + PAGE_SIZE * i);
+    }
+    return guard_page + PAGE_SIZE;
+}
+
 //从内核堆中分配内存
 void* Memory::malloc_kernel(uint32_t size)
 {
@@ -346,7 +458,7 @@ void* Memory::malloc(uint32_t size)
     else
     {
         MemoryBlockDescript* descript =
-            is_kernel ? memory_block_decript : Thread::get_current_pcb()->user_block_descript;
+            is_kernel ? memory_block_decript : Thread::get_current_pcb()->process->user_block_descript;
         for (; descript->block_size < size; descript++) {}
         if (descript->free_list.is_empty())
         {
@@ -385,27 +497,33 @@ void* Memory::get_phsical_address_by_virtual_address(void* virtual_address)
     return (void*)((*pte & 0xfffff000) + (((uint32_t)virtual_address) & 0x00000fff));
 }
 
+//释放用户虚页对应的实页并清除pte,不刷新tlb
+void release_user_physical_page(void* virtual_addr)
+{
+    //释放实页,合并过的实页还被其他虚页引用时只减少引用计数
+    uint32_t paddr = (uint32_t)Memory::get_phsical_address_by_virtual_address(virtual_addr);
+    ASSERT(paddr % PAGE_SIZE == 0);
+    put_user_frame(paddr);
+    Resource::uncharge(Thread::get_current_pcb(), ResourceType::memory, 1);
+    //释放pte，为了简化操作，pde不释放，等进程结束了回收pde
+    uint32_t* pte = (uint32_t*)get_pte_pointer(virtual_addr);
+    *pte &= ~PG_P_1;  // 将页表项pte的P位置0
+}
+
 void free_user_page(void* virtual_addr, uint32_t count)
 {
     uint32_t vaddr = (uint32_t)virtual_addr;
     ASSERT(vaddr % PAGE_SIZE == 0);
-    uint32_t p_start_address = (uint32_t)user_memory_pool.physical_address_pool.start_address;
     uint32_t v_start_address = (uint32_t)Thread::get_current_pcb()->user_virutal_address_pool.start_address;
     // uint32_t v_start_address = (uint32_t)user_memory_pool.virtual_address_pool.start_address;
     for (uint32_t i = 0; i < count; i++)
     {
-        //释放实页
-        uint32_t paddr = (uint32_t)Memory::get_phsical_address_by_virtual_address((void*)vaddr);
-        ASSERT(paddr % PAGE_SIZE == 0);
-        ASSERT(paddr >= p_start_address);
-        uint32_t p_index = (paddr - p_start_address) / PAGE_SIZE;
-        ASSERT(user_memory_pool.physical_address_pool.bitmap.test(p_index));
-        user_memory_pool.physical_address_pool.bitmap.set(p_index, false);
-        //释放pte，为了简化操作，pde不释放，等进程结束了回收pde
-        uint32_t* pte = (uint32_t*)get_pte_pointer((void*)vaddr);
-        *pte &= ~PG_P_1;  // 将页表项pte的P位置0
-        // asm volatile("invlpg %0" ::"m"(vaddr) : "memory");  //更新tlb
-        Process::activate_page_directory(Thread::get_current_pcb());  //更新tlb,i386不支持invlpg
+        //被madvise释放过的页没有实页,只需释放虚页
+        if (Memory::is_page_present((void*)vaddr))
+        {
+            release_user_physical_page((void*)vaddr);
+            flush_tlb();
+        }
 
         //释放虚页
         ASSERT(vaddr >= v_start_address);
@@ -435,8 +553,7 @@ void free_kernel_page(void* virtual_addr, uint32_t count)
         //释放pte，为了简化操作，pde不释放，等进程结束了回收pde
         uint32_t* pte = (uint32_t*)get_pte_pointer((void*)vaddr);
         *pte &= ~PG_P_1;  // 将页表项pte的P位置0
-        // asm volatile("invlpg %0" ::"m"(vaddr) : "memory");  //更新tlb
-        Process::activate_page_directory(Thread::get_current_pcb());  //更新tlb,i386不支持invlpg
+        flush_tlb();
 
         //释放虚页
         ASSERT(vaddr >= v_start_address);
@@ -520,4 +637,439 @@ void Memory::malloc_physical_page_for_virtual_page(bool is_kernel, void* virtual
     {
         map_page(physical_page, virtual_page);
     }
-}
\ No newline at end of file
+}
+
+//用户虚页是否已在进程的虚拟地址池中分配
+bool is_user_virtual_page_allocated(PCB* pcb, uint32_t vaddr)
+{
+    uint32_t start = (uint32_t)pcb->user_virutal_address_pool.start_address;
+    if (vaddr < start)
+    {
+        return false;
+    }
+    uint32_t index = (vaddr - start) / PAGE_SIZE;
+    if (index >= pcb->user_virutal_address_pool.bitmap.byte_size * 8)
+    {
+        return false;
+    }
+    return pcb->user_virutal_address_pool.bitmap.test(index);
+}
+
+bool Memory::is_user_range_allocated(PCB* pcb, uint32_t start, uint32_t size)
+{
+    if (size == 0 || start + size < start || start + size > 0xc0000000)
+    {
+        return false;
+    }
+    for (uint32_t vaddr = start & 0xfffff000; vaddr < start + size; vaddr += PAGE_SIZE)
+    {
+        if (!is_user_virtual_page_allocated(pcb->process, vaddr))
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+/* 为[vaddr, vaddr + count页)中已分配但未映射的用户虚页分配实页并清零,
+ * 未映射的页不会被tlb缓存,所以只需在最后刷新一次tlb。实页不足或超出内存限制时返回false */
+bool populate_user_page(PCB* pcb, uint32_t vaddr, uint32_t count)
+{
+    bool     success = true;
+    uint32_t mapped  = 0;
+    for (uint32_t i = 0; i < count; i++, vaddr += PAGE_SIZE)
+    {
+        if (!is_user_virtual_page_allocated(pcb, vaddr) || Memory::is_page_present((void*)vaddr))
+        {
+            continue;
+        }
+        if (!Resource::charge(pcb, ResourceType::memory, 1))
+        {
+            success = false;
+            break;
+        }
+        void* physical_page = malloc_one_user_physical_page();
+        if (physical_page == nullptr)
+        {
+            Resource::uncharge(pcb, ResourceType::memory, 1);
+            success = false;
+            break;
+        }
+        install_page(physical_page, (void*)vaddr);
+        memset((void*)vaddr, 0, PAGE_SIZE);
+        mapped++;
+    }
+    if (mapped > 0)
+    {
+        flush_tlb();
+    }
+    return success;
+}
+
+//内核态访问用户内存时不能因超出内存限制失败,仍为vaddr映射一页并计入使用量,实页不足时返回false
+bool populate_user_page_over_limit(PCB* pcb, uint32_t vaddr)
+{
+    void* physical_page = malloc_one_user_physical_page();
+    if (physical_page == nullptr)
+    {
+        return false;
+    }
+    pcb->process->resource_usage.memory_pages++;
+    install_page(physical_page, (void*)vaddr);
+    memset((void*)vaddr, 0, PAGE_SIZE);
+    flush_tlb();
+    return true;
+}
+
+//查找包含vaddr的使用建议区间,找不到时返回nullptr
+MemoryAdviceRange* find_memory_advice(PCB* pcb, uint32_t vaddr)
+{
+    for (auto& range : pcb->process->memory_advice)
+    {
+        if (range.start != 0 && range.start <= vaddr && vaddr < range.end)
+        {
+            return &range;
+        }
+    }
+    return nullptr;
+}
+
+//记录[start, end)的使用建议,与之重叠的旧建议整体失效
+int32_t set_memory_advice(PCB* pcb, uint32_t start, uint32_t end, MemoryAdvice advice)
+{
+    MemoryAdviceRange* free_range = nullptr;
+    for (auto& range : pcb->process->memory_advice)
+    {
+        if (range.start != 0 && range.start < end && start < range.end)
+        {
+            range.start = 0;
+        }
+        if (range.start == 0 && free_range == nullptr)
+        {
+            free_range = &range;
+        }
+    }
+    if (advice == MemoryAdvice::normal)
+    {  // normal等同于没有建议
+        return 0;
+    }
+    if (free_range == nullptr)
+    {
+        return -1;
+    }
+    free_range->start  = start;
+    free_range->end    = end;
+    free_range->advice = advice;
+    return 0;
+}
+
+int32_t Memory::madvise(void* address, uint32_t length, MemoryAdvice advice)
+{
+    AtomicGuard guard;
+    PCB*        pcb   = Thread::get_current_pcb();
+    uint32_t    start = (uint32_t)address;
+    if (!Thread::is_user_thread(pcb) || start % PAGE_SIZE != 0 || length == 0)
+    {
+        return -1;
+    }
+    uint32_t count = div_round_up(length, PAGE_SIZE);
+    uint32_t end   = start + count * PAGE_SIZE;
+    for (uint32_t vaddr = start; vaddr < end; vaddr += PAGE_SIZE)
+    {
+        if (!is_user_virtual_page_allocated(pcb, vaddr))
+        {  //只能对已分配的内存给出建议
+            return -1;
+        }
+    }
+    switch (advice)
+    {
+        case MemoryAdvice::willneed: return populate_user_page(pcb, start, count) ? 0 : -1;
+        case MemoryAdvice::dontneed:
+        {
+            //释放实页但保留虚页,再次访问时由缺页中断重新分配清零的实页
+            bool released = false;
+            for (uint32_t vaddr = start; vaddr < end; vaddr += PAGE_SIZE)
+            {
+                if (is_page_present((void*)vaddr))
+                {
+                    release_user_physical_page((void*)vaddr);
+                    released = true;
+                }
+            }
+            if (released)
+            {
+                flush_tlb();
+            }
+            return 0;
+        }
+        case MemoryAdvice::normal:
+        case MemoryAdvice::random:
+        case MemoryAdvice::sequential: return set_memory_advice(pcb, start, end, advice);
+        default: return -1;
+    }
+}
+
+/****************************  同页合并  ****************************
+ * 后台线程定期计算所有用户页的哈希值,把内容完全相同的页合并为同一个只读的实页,
+ * 写合并页时触发缺页中断,再为写者复制出私有的实页。
+ *******************************************************************/
+
+//同页合并哈希表的表项
+struct PageMergeEntry
+{
+    uint32_t hash;   // 页内容的哈希值
+    PCB*     pcb;    // 页所属的进程,为nullptr表示此项未使用
+    uint32_t vaddr;  // 页的虚拟地址
+    uint32_t paddr;  // 扫描时页对应的实页
+};
+
+PCB*            page_merge_thread;  // 同页合并的扫描线程
+WaitQueue       page_merge_wait;    // 同页合并关闭时扫描线程在此等待
+PageMergeEntry* page_merge_table;   // 每轮扫描重新建立的哈希表
+void*           page_merge_buffer;  // 跨页表复制页内容时使用的内核缓冲区
+
+#define PAGE_MERGE_TABLE_SIZE (PAGE_MERGE_TABLE_PAGES * PAGE_SIZE / sizeof(PageMergeEntry))
+
+//计算一页内容的哈希值(FNV-1a)
+uint32_t hash_page(uint32_t vaddr)
+{
+    uint32_t* data = (uint32_t*)vaddr;
+    uint32_t  hash = 2166136261U;
+    for (uint32_t i = 0; i < PAGE_SIZE / sizeof(uint32_t); i++)
+    {
+        hash = (hash ^ data[i]) * 16777619U;
+    }
+    return hash;
+}
+
+//写合并页时复制出私有的实页,实页不足时返回false
+bool split_merged_page(uint32_t vaddr)
+{
+    uint32_t* pte   = (uint32_t*)get_pte_pointer((void*)vaddr);
+    uint32_t  paddr = *pte & 0xfffff000;
+    if (user_frame_reference[get_user_frame_index(paddr)] == 1)
+    {  //其他共享者都已经分离,直接恢复可写
+        *pte |= PG_RW_W;
+        flush_tlb();
+        return true;
+    }
+    void* physical_page = malloc_one_user_physical_page();
+    if (physical_page == nullptr)
+    {
+        return false;
+    }
+    memcpy(page_merge_buffer, (void*)vaddr, PAGE_SIZE);
+    *pte = (uint32_t)physical_page | PG_US_U | PG_RW_W | PG_P_1;
+    flush_tlb();
+    memcpy((void*)vaddr, page_merge_buffer, PAGE_SIZE);
+    put_user_frame(paddr);
+    return true;
+}
+
+//需要在关中断时调用,split_merged_page使用共享的page_merge_buffer
+bool Memory::unshare_user_page(uint32_t vaddr)
+{
+    ASSERT(!Interrupt::is_enabled() && is_page_present((void*)vaddr));
+    if (*(uint32_t*)get_pte_pointer((void*)vaddr) & PG_RW_W)
+    {
+        return true;
+    }
+    return split_merged_page(vaddr & 0xfffff000);
+}
+
+/* 把当前页表中的页(vaddr, paddr)合并到entry记录的实页上,
+ * 调用时已关中断且当前页表属于page的所有者 */
+void merge_page(PageMergeEntry* entry, PCB* pcb, uint32_t vaddr, uint32_t paddr)
+{
+    //确认entry中的页没有变化,并将其设为只读
+    Process::activate_page_directory(entry->pcb);
+    uint32_t* pte   = (uint32_t*)get_pte_pointer((void*)entry->vaddr);
+    bool      valid = Memory::is_page_present((void*)entry->vaddr) && (*pte & 0xfffff000) == entry->paddr;
+    if (valid && Futex::has_waiters(entry->paddr))
+    {  //记录entry之后,扫描其他进程期间可能有线程开始在这一页上等待
+        valid = false;
+    }
+    if (valid)
+    {
+        memcpy(page_merge_buffer, (void*)entry->vaddr, PAGE_SIZE);
+        *pte &= ~PG_RW_W;
+    }
+    Process::activate_page_directory(pcb);
+    if (!valid || memcmp(page_merge_buffer, (void*)vaddr, PAGE_SIZE) != 0)
+    {
+        return;
+    }
+    //内容完全一致,改为只读映射到entry的实页
+    get_user_frame(entry->paddr);
+    *(uint32_t*)get_pte_pointer((void*)vaddr) = entry->paddr | PG_US_U | PG_RW_R | PG_P_1;
+    Process::activate_page_directory(pcb);  //扫描线程是内核线程,不能用flush_tlb刷新
+    put_user_frame(paddr);
+}
+
+//扫描一个进程的所有用户页,与哈希表中内容相同的页合并
+void scan_process_page(PCB* pcb)
+{
+    AtomicGuard guard;
+    auto&       pool = pcb->user_virutal_address_pool;
+    Process::activate_page_directory(pcb);
+    for (uint32_t byte_index = 0; byte_index < pool.bitmap.byte_size; byte_index++)
+    {
+        if (pool.bitmap.start_address[byte_index] == 0)
+        {
+            continue;
+        }
+        for (uint32_t i = byte_index * 8; i < byte_index * 8 + 8; i++)
+        {
+            uint32_t vaddr = (uint32_t)pool.start_address + i * PAGE_SIZE;
+            if (!pool.bitmap.test(i) || !Memory::is_page_present((void*)vaddr))
+            {
+                continue;
+            }
+            uint32_t paddr = *(uint32_t*)get_pte_pointer((void*)vaddr) & 0xfffff000;
+            if (!is_user_frame(paddr) || Futex::has_waiters(paddr))
+            {  //有futex等待者的页合并后物理地址会改变,不合并
+                continue;
+            }
+            uint32_t hash = hash_page(vaddr);
+            //开放寻址,表满时不再插入
+            for (uint32_t probe = 0; probe < PAGE_MERGE_TABLE_SIZE; probe++)
+            {
+                PageMergeEntry* entry = &page_merge_table[(hash + probe) % PAGE_MERGE_TABLE_SIZE];
+                if (entry->pcb == nullptr)
+                {
+                    entry->hash  = hash;
+                    entry->pcb   = pcb;
+                    entry->vaddr = vaddr;
+                    entry->paddr = paddr;
+                    break;
+                }
+                if (entry->hash == hash)
+                {
+                    if (entry->paddr != paddr)
+                    {
+                        merge_page(entry, pcb, vaddr, paddr);
+                    }
+                    break;
+                }
+            }
+        }
+    }
+    Process::activate_page_directory(Thread::get_current_pcb());
+}
+
+bool scan_thread_page(PCB* pcb, void* arg)
+{
+    UNUSED(arg);
+    if (Thread::is_user_thread(pcb) && pcb->status != TaskStatus::died && pcb->process == pcb)
+    {  //clone出的线程与主线程共享页表,只扫描主线程
+        scan_process_page(pcb);
+        Thread::yield();  //每扫描完一个进程就让出cpu
+    }
+    return false;
+}
+
+void page_merge(void* arg)
+{
+    UNUSED(arg);
+    while (true)
+    {
+        {
+            AtomicGuard guard;
+            while (!page_merge_state.enabled)
+            {  //关闭时等待,直到set_page_merge唤醒;扫描间隔的sleep中不在队列里,不会被提前唤醒
+                page_merge_wait.wait();
+            }
+        }
+        memset(page_merge_table, 0, PAGE_MERGE_TABLE_PAGES * PAGE_SIZE);
+        Thread::for_each_thread(scan_thread_page, nullptr);
+        page_merge_state.full_scans++;
+        Timer::sleep(PAGE_MERGE_INTERVAL);
+    }
+}
+
+//需要在线程初始化之后调用
+void Memory::init_page_merge()
+{
+    printkln("page merge init start");
+    uint32_t frame_count    = user_memory_pool.physical_address_pool.size / PAGE_SIZE;
+    uint32_t reference_size = frame_count * sizeof(uint16_t);
+    user_frame_reference    = (uint16_t*)malloc_kernel_page(div_round_up(reference_size, PAGE_SIZE));
+    memset(user_frame_reference, 0, reference_size);
+    page_merge_table  = (PageMergeEntry*)malloc_kernel_page(PAGE_MERGE_TABLE_PAGES);
+    page_merge_buffer = malloc_kernel_page(1);
+    page_merge_state  = PageMergeState();
+    page_merge_wait   = WaitQueue();
+    page_merge_thread = Thread::create_thread("page_merge", 31, page_merge, nullptr);
+    printkln("page merge init done");
+}
+
+//打开或关闭同页合并,已合并的页不会因关闭而分离
+void Memory::set_page_merge(bool enable)
+{
+    AtomicGuard guard;
+    page_merge_state.enabled = enable;
+    if (enable)
+    {
+        page_merge_wait.wake_all();
+    }
+}
+
+void Memory::get_page_merge_state(PageMergeState* state)
+{
+    AtomicGuard guard;
+    *state = page_merge_state;
+}
+
+//缺页中断处理函数,为已分配虚页但还没有实页的用户内存按需映射
+void page_fault_handler(uint32_t no)
+{
+    uint32_t page_fault_vaddr = 0;
+    asm("movl %%cr2, %0" : "=r"(page_fault_vaddr));  // cr2是存放造成page_fault的地址
+    InterruptStack* stack = (InterruptStack*)&no;  // 中断号是栈中中断上下文的第一项
+    PCB*            pcb   = Thread::get_current_pcb();
+    uint32_t        vaddr = page_fault_vaddr & 0xfffff000;
+    if (Thread::is_user_thread(pcb) && is_user_virtual_page_allocated(pcb, vaddr) &&
+        !Memory::is_page_present((void*)vaddr))
+    {
+        //顺序访问时把之后的页一起映射,减少缺页次数
+        uint32_t           count = 1;
+        MemoryAdviceRange* range = find_memory_advice(pcb, vaddr);
+        if (range != nullptr && range->advice == MemoryAdvice::sequential)
+        {
+            count = min((uint32_t)FAULT_AROUND_PAGES, (range->end - vaddr) / PAGE_SIZE);
+        }
+        if (populate_user_page(pcb, vaddr, count) || Memory::is_page_present((void*)vaddr))
+        {
+            return;
+        }
+        if (pcb->process->resource_usage.memory_pages >=
+            pcb->process->resource_limit[(uint32_t)ResourceType::memory])
+        {
+            if ((stack->cs & 3) == 3)
+            {  //用户态访问时结束整个进程,其他线程在返回用户态时退出
+                printkln("pid %d exceeds memory limit at %x, killed", pcb->process->pid, page_fault_vaddr);
+                pcb->process->killed = true;
+                Thread::exit_current_thread();
+            }
+            //内核态访问时线程可能持有锁,不能结束,映射这一页后让系统调用返回-1
+            if (populate_user_page_over_limit(pcb, vaddr))
+            {
+                pcb->memory_fault = true;
+                return;
+            }
+        }
+        printkln("malloc one user physical page failed");
+    }
+    else if (Thread::is_user_thread(pcb) && is_user_virtual_page_allocated(pcb, vaddr) &&
+             !(*(uint32_t*)get_pte_pointer((void*)vaddr) & PG_RW_W))
+    {  //用户页只有被合并后才是只读的,此时是写合并页
+        if (split_merged_page(vaddr))
+        {
+            return;
+        }
+        printkln("malloc one user physical page failed");
+    }
+    printkln("interrupt excetion no: %d, name: #PF Page-Fault Exception, pid: %d, user: %s", no, pcb->pid, pcb->name);
+    printkln("page fault addr is %x", page_fault_vaddr);
+    Debug::hlt();
+}
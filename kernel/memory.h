@@ -5,12 +5,43 @@
 //一页内存的大小
 #define PAGE_SIZE 4096
 
+struct PCB;
+
 struct VirtualAddressPool
 {
     Bitmap bitmap;         //记录虚拟地址使用情况
     void*  start_address;  //虚拟起始地址
 };
 
+//用户对一段内存的使用建议,取值与linux的madvise一致
+enum class MemoryAdvice : uint32_t
+{
+    normal,      // 无特殊建议,缺页时只映射一页
+    random,      // 随机访问,缺页时只映射一页
+    sequential,  // 顺序访问,缺页时预先映射之后的若干页
+    willneed,    // 即将访问,立即为整段内存分配实页
+    dontneed     // 暂不访问,释放实页但保留虚拟地址
+};
+
+//记录进程对一段虚拟地址的使用建议
+struct MemoryAdviceRange
+{
+    uint32_t     start;  //起始虚拟地址,为0表示此项未使用
+    uint32_t     end;    //结束虚拟地址(不包含)
+    MemoryAdvice advice;
+};
+
+#define MAX_ADVICE_RANGE_PER_PROCESS 4  //每个进程最多记录的建议区间数
+
+//同页合并的状态
+struct PageMergeState
+{
+    bool     enabled      = false;  //是否正在合并
+    uint32_t pages_shared = 0;      //被多个虚页共享的实页数
+    uint32_t pages_saved  = 0;      //合并后节省的实页数
+    uint32_t full_scans   = 0;      //完成的全量扫描次数
+};
+
 //用于描述一种block类型的内存管理
 struct MemoryBlockDescript
 {
@@ -24,7 +55,10 @@ namespace Memory
 {
     void  init();
     void* get_phsical_address_by_virtual_address(void* vaddr);
+    bool  is_page_present(void* vaddr);
     void* malloc_kernel_page(uint32_t count);
+    //分配count页的内核栈,其下多占一页虚拟地址但不映射,作为溢出时触发缺页的保护页,返回栈的最低地址
+    void* malloc_kernel_stack(uint32_t count);
     void* malloc_user_page(uint32_t count);
     //为虚页分配实页,并重新加载当前进程的页表
     void  malloc_physical_page_for_virtual_page(bool is_kernel, void* virtual_page);
@@ -33,4 +67,14 @@ namespace Memory
     void  init_block_descript(MemoryBlockDescript* descript);
     void* malloc_kernel(uint32_t size);
     void  free_kernel(void* p);
+    //[start, start+size)是否都在pcb所属进程已分配的用户虚页中,内核检查用户传入的地址时使用
+    bool is_user_range_allocated(PCB* pcb, uint32_t start, uint32_t size);
+    //已映射的用户页vaddr是同页合并后的只读页时为当前进程复制出私有的可写页,实页不足时返回false
+    bool unshare_user_page(uint32_t vaddr);
+    //对[address, address+length)的用户内存给出使用建议,成功返回0,失败返回-1
+    int32_t madvise(void* address, uint32_t length, MemoryAdvice advice);
+    //同页合并需要创建扫描线程,在线程初始化之后调用
+    void init_page_merge();
+    void set_page_merge(bool enable);
+    void get_page_merge_state(PageMergeState* state);
 }  // namespace Memory
@@ -8,8 +8,8 @@
 Pipe::Pipe()
 {
     AtomicGuard guard;
-    queue  = (IOQueue*)Memory::malloc_kernel(sizeof(queue));  //把队列放在内核中，方便所有进程共享
-    *queue = IOQueue();                                       //初始化
+    queue  = (IOQueue*)Memory::malloc_kernel(sizeof(IOQueue));  //把队列放在内核中，方便所有进程共享
+    *queue = IOQueue();                                         //初始化
     reference_count = 1;
 }
 
@@ -46,6 +46,30 @@ void Pipe::write(const void* buffer, uint32_t count)
     }
 }
 
+uint32_t Pipe::try_read(void* buffer, uint32_t count)
+{
+    AtomicGuard guard;
+    char*       data = (char*)buffer;
+    uint32_t    i    = 0;
+    for (; i < count && !queue->is_empty(); i++)
+    {
+        data[i] = queue->pop_front();
+    }
+    return i;
+}
+
+uint32_t Pipe::try_write(const void* buffer, uint32_t count)
+{
+    AtomicGuard guard;
+    const char* data = (const char*)buffer;
+    uint32_t    i    = 0;
+    for (; i < count && !queue->is_full(); i++)
+    {
+        queue->push_back(data[i]);
+    }
+    return i;
+}
+
 //为了共享pipe，需要把inode放在内核空间中
 void* Pipe::operator new(__SIZE_TYPE__ size)
 {
@@ -8,9 +8,12 @@ public:
     ~Pipe();
     void  read(void* buffer, uint32_t count);
     void  write(const void* buffer, uint32_t count);
-    void* operator new(__SIZE_TYPE__ size);
-    void  operator delete(void* p);
-    void  add_reference_count();
+    //不阻塞,返回实际读写的字节数,管道空或满时返回0
+    uint32_t try_read(void* buffer, uint32_t count);
+    uint32_t try_write(const void* buffer, uint32_t count);
+    void*    operator new(__SIZE_TYPE__ size);
+    void     operator delete(void* p);
+    void     add_reference_count();
 
 private:
     class IOQueue* queue;
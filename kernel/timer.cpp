@@ -1,23 +1,50 @@
 #include "kernel/timer.h"
 #include "kernel/asm_interface.h"
+#include "kernel/clock.h"
 #include "kernel/interrupt.h"
+#include "kernel/vdso.h"
 #include "lib/debug.h"
 #include "lib/macro.h"
 #include "lib/math.h"
+#include "process/resource.h"
 #include "thread/thread.h"
 
-#define IRQ0_FREQUENCY 100
 #define INPUT_FREQUENCY 1193180
-#define COUNTER0_VALUE INPUT_FREQUENCY / IRQ0_FREQUENCY
+#define COUNTER0_VALUE (INPUT_FREQUENCY / IRQ0_FREQUENCY)
 #define CONTRER0_PORT 0x40
 #define COUNTER0_NO 0
-#define COUNTER_MODE 2
+#define COUNTER_MODE 2           // 周期模式,计数到0后自动重新装入初值
+#define COUNTER_MODE_ONE_SHOT 0  // 单次模式,计数到0时产生一次中断后不再重新装入
 #define READ_WRITE_LATCH 3
+#define LATCH_COUNTER 0  // 锁存计数器的当前值以便读取
 #define PIT_CONTROL_PORT 0x43
+#define MAX_COUNTER_VALUE 0xffff
+#define MAX_IDLE_TICKS (MAX_COUNTER_VALUE / COUNTER0_VALUE)  // 单次模式下最多跳过的嘀嗒数
 
 #define MSECONDS_PER_INTERRUPT (1000 / IRQ0_FREQUENCY)
+#define USLEEP_SPIN_MAX_NS 1000000  // usleep剩余的时间不超过此纳秒数时才自旋等待,否则阻塞
 
-uint32_t ticks;  // ticks是内核自中断开启以来总共的嘀嗒数
+#define TVR_BITS 8  // 第一级时间轮的槽数为2^TVR_BITS,每个槽对应一个嘀嗒
+#define TVN_BITS 6  // 之后每级时间轮的槽数为2^TVN_BITS,每个槽对应上一级整个轮的时间
+#define TVN_LEVELS 4
+#define TVR_SIZE (1 << TVR_BITS)
+#define TVN_SIZE (1 << TVN_BITS)
+#define TVR_MASK (TVR_SIZE - 1)
+#define TVN_MASK (TVN_SIZE - 1)
+
+uint32_t ticks;               // ticks是内核自中断开启以来总共的嘀嗒数
+uint32_t quota_refill_ticks;  // 上次恢复cpu配额时的嘀嗒数
+uint32_t one_shot_counts;     // 单次模式下设置的计数值,为0表示处于周期模式
+uint32_t remainder_counts;    // 单次模式结束时不足一个嘀嗒的计数,计入下一次
+
+/* 分级时间轮,第一级的每个槽存放在对应嘀嗒到期的定时器,
+ * 更远的定时器按到期时间放入后面的级,在前一级转完一圈时逐级下放 */
+struct TimerWheel
+{
+    List     tvr[TVR_SIZE];
+    List     tvn[TVN_LEVELS][TVN_SIZE];
+    uint32_t timer_ticks;  // 下一个要处理的嘀嗒,之前的定时器都已处理
+} timer_wheel;
 
 /* 把操作的计数器counter_no、读写锁属性rwl、计数器模式counter_mode写入模式控制寄存器并赋予初始值counter_value */
 void frequency_set(uint8_t counter_port, uint8_t counter_no, uint8_t rwl, uint8_t counter_mode, uint16_t counter_value)
@@ -27,43 +54,278 @@ void frequency_set(uint8_t counter_port, uint8_t counter_no, uint8_t rwl, uint8_
     /* 先写入counter_value的低8位 */
     outb(counter_port, (uint8_t)counter_value);
     /* 再写入counter_value的高8位 */
-    outb(counter_port, (uint8_t)counter_value >> 8);
+    outb(counter_port, (uint8_t)(counter_value >> 8));
 }
 
-/* 时钟的中断处理函数 */
-void timer_interrupt_handler()
+//读取计数器0的当前值
+uint16_t read_counter()
 {
-    PCB* current_thread = Thread::get_current_pcb();
-    ASSERT(Thread::is_pcb_valid(current_thread));  // 检查栈是否溢出
-    current_thread->elapsed_ticks++;               // 记录此线程占用的cpu时间嘀
-    ticks++;  //从内核第一次处理时间中断后开始至今的滴哒数,内核态和用户态总共的嘀哒数
-    if (current_thread->ticks == 0)
-    {  // 若进程时间片用完就开始调度新的进程上cpu
-        Thread::yield();
+    outb(PIT_CONTROL_PORT, (uint8_t)(COUNTER0_NO << 6 | LATCH_COUNTER << 4));
+    uint8_t low  = inb(CONTRER0_PORT);
+    uint8_t high = inb(CONTRER0_PORT);
+    return (uint16_t)(high << 8 | low);
+}
+
+//按到期时间把定时器放入对应的时间轮槽
+void insert_timer(KernelTimer* timer)
+{
+    uint32_t expires = timer->expires;
+    uint32_t delta   = expires - timer_wheel.timer_ticks;
+    List*    slot    = nullptr;
+    if ((int32_t)delta < 0)
+    {  //已经到期的定时器在下一个嘀嗒处理
+        slot = &timer_wheel.tvr[timer_wheel.timer_ticks & TVR_MASK];
+    }
+    else if (delta < TVR_SIZE)
+    {
+        slot = &timer_wheel.tvr[expires & TVR_MASK];
     }
     else
-    {  // 将当前进程的时间片-1
-        current_thread->ticks--;
+    {
+        uint32_t level = 0;
+        while (level < TVN_LEVELS - 1 && delta >= 1U << (TVR_BITS + (level + 1) * TVN_BITS))
+        {
+            level++;
+        }
+        slot = &timer_wheel.tvn[level][(expires >> (TVR_BITS + level * TVN_BITS)) & TVN_MASK];
+    }
+    slot->push_back(timer->tag);
+}
+
+//把第level级index槽的定时器重新放入时间轮,返回index
+uint32_t cascade_timer(uint32_t level, uint32_t index)
+{
+    List& slot = timer_wheel.tvn[level][index];
+    while (!slot.is_empty())
+    {
+        insert_timer((KernelTimer*)slot.pop_front());  // tag是KernelTimer的第一个成员
+    }
+    return index;
+}
+
+//处理所有到期的定时器
+void run_timers()
+{
+    while ((int32_t)(ticks - timer_wheel.timer_ticks) >= 0)
+    {
+        uint32_t index = timer_wheel.timer_ticks & TVR_MASK;
+        //第一级转完一圈,从下一级取出接下来一圈的定时器,下一级也转完一圈时继续向上取
+        for (uint32_t level = 0; index == 0 && level < TVN_LEVELS; level++)
+        {
+            uint32_t tvn_index = (timer_wheel.timer_ticks >> (TVR_BITS + level * TVN_BITS)) & TVN_MASK;
+            if (cascade_timer(level, tvn_index) != 0)
+            {
+                break;
+            }
+        }
+        timer_wheel.timer_ticks++;
+        List& slot = timer_wheel.tvr[index];
+        while (!slot.is_empty())
+        {
+            KernelTimer* timer = (KernelTimer*)slot.pop_front();
+            if (timer->period != 0)
+            {  //先重新加入,回调中可以取消周期定时器
+                timer->expires += timer->period;
+                insert_timer(timer);
+            }
+            timer->callback(timer->arg);
+        }
+    }
+}
+
+void Timer::init_timer(KernelTimer* timer, TimerCallback_t callback, void* arg)
+{
+    ASSERT(callback != nullptr);
+    timer->tag.init();
+    timer->expires  = 0;
+    timer->period   = 0;
+    timer->callback = callback;
+    timer->arg      = arg;
+}
+
+void Timer::add_timer(KernelTimer* timer, uint32_t delay, uint32_t period)
+{
+    AtomicGuard guard;
+    ASSERT(!is_timer_pending(timer));
+    timer->expires = ticks + delay;
+    timer->period  = period;
+    insert_timer(timer);
+}
+
+bool Timer::cancel_timer(KernelTimer* timer)
+{
+    AtomicGuard guard;
+    if (!is_timer_pending(timer))
+    {
+        return false;
+    }
+    timer->tag.remove_from_list();
+    return true;
+}
+
+bool Timer::is_timer_pending(KernelTimer* timer)
+{
+    return timer->tag.next != nullptr;
+}
+
+uint32_t Timer::get_ticks()
+{
+    return ticks;
+}
+
+uint32_t Timer::msecond_to_ticks(uint32_t msecond)
+{
+    return div_round_up(msecond, MSECONDS_PER_INTERRUPT);
+}
+
+//下一个定时器到期前的嘀嗒数,最多查找max个嘀嗒
+uint32_t get_next_timer_delta(uint32_t max)
+{
+    for (uint32_t i = 0; i < max; i++)
+    {
+        uint32_t index = (timer_wheel.timer_ticks + i) & TVR_MASK;
+        if (!timer_wheel.tvr[index].is_empty() || (index == 0 && i > 0))
+        {  //第一级转完一圈时要从下一级取定时器,不能跳过
+            return i + 1;
+        }
     }
+    return max;
 }
 
-// 以tick为单位的sleep,任何时间形式的sleep会转换此ticks形式
-void ticks_to_sleep(uint32_t sleep_ticks)
+//时间前进count个嘀嗒,单次模式结束时count可以大于1
+void advance_ticks(uint32_t count)
 {
-    uint32_t start_tick = ticks;
-    while (ticks - start_tick < sleep_ticks)
+    ticks += count;  //从内核第一次处理时间中断后开始至今的滴哒数,内核态和用户态总共的嘀哒数
+    Vdso::update_ticks(ticks);
+    run_timers();
+    if (ticks - quota_refill_ticks >= CPU_QUOTA_PERIOD)
     {
-        // 若间隔的ticks数不够便让出cpu
-        Thread::yield();
+        quota_refill_ticks = ticks;
+        Resource::refill_cpu_quota();
     }
 }
 
+//退出单次模式,恢复周期模式,返回单次模式期间经过的嘀嗒数
+uint32_t stop_one_shot()
+{
+    uint16_t counter = read_counter();
+    //计数到0后计数器会从0xffff继续递减,此时已经过全部计数
+    uint32_t elapsed = counter <= one_shot_counts ? one_shot_counts - counter : one_shot_counts;
+    frequency_set(CONTRER0_PORT, COUNTER0_NO, READ_WRITE_LATCH, COUNTER_MODE, COUNTER0_VALUE);
+    one_shot_counts = 0;
+    remainder_counts += elapsed;
+    uint32_t count   = remainder_counts / COUNTER0_VALUE;
+    remainder_counts = remainder_counts % COUNTER0_VALUE;
+    return count;
+}
+
+void Timer::enter_idle()
+{
+    ASSERT(!Interrupt::is_enabled());
+    if (one_shot_counts != 0 || Thread::is_reschedule_needed())
+    {
+        return;
+    }
+    uint32_t delta = get_next_timer_delta(MAX_IDLE_TICKS);
+    //被cpu配额暂停的线程要按时恢复
+    uint32_t quota_delta = quota_refill_ticks + CPU_QUOTA_PERIOD - ticks;
+    delta                = min(delta, quota_delta);
+    if (delta <= 1)
+    {
+        return;
+    }
+    one_shot_counts = delta * COUNTER0_VALUE;
+    frequency_set(CONTRER0_PORT, COUNTER0_NO, READ_WRITE_LATCH, COUNTER_MODE_ONE_SHOT, one_shot_counts);
+}
+
+//其他中断唤醒idle线程时,补上单次模式期间经过的嘀嗒
+void Timer::exit_idle()
+{
+    ASSERT(!Interrupt::is_enabled());
+    if (one_shot_counts == 0)
+    {
+        return;
+    }
+    uint32_t count = stop_one_shot();
+    if (count > 0)
+    {
+        advance_ticks(count);
+    }
+}
+
+/* 时钟的中断处理函数 */
+void timer_interrupt_handler()
+{
+    PCB* current_thread = Thread::get_current_pcb();
+    ASSERT(Thread::is_pcb_valid(current_thread));  // 栈溢出由保护页发现,这里检查pcb是否被破坏
+    uint32_t count = 1;
+    if (one_shot_counts != 0)
+    {
+        count = max(stop_one_shot(), 1U);
+    }
+    advance_ticks(count);
+    //cpu配额用尽或时间片用完时只做标记,在中断返回前才切换线程
+    if (Resource::charge_tick(current_thread))
+    {
+        Thread::schedule_tick(ticks);
+    }
+}
+
+void wake_up_thread(void* thread)
+{
+    Thread::unblock_thread((PCB*)thread);
+}
+
+// 以tick为单位的sleep,任何时间形式的sleep会转换此ticks形式,睡眠期间线程不在就绪队列中
+void Timer::sleep_ticks(uint32_t count)
+{
+    KernelTimer timer;  //线程醒来前定时器一定已经触发,可以放在栈上
+    init_timer(&timer, wake_up_thread, Thread::get_current_pcb());
+    AtomicGuard guard;
+    add_timer(&timer, count, 0);
+    Thread::block_current_thread();
+}
+
 // 以毫秒为单位的sleep   1秒= 1000毫秒
 void Timer::sleep(uint32_t msecond)
 {
-    uint32_t sleep_ticks = div_round_up(msecond, MSECONDS_PER_INTERRUPT);
-    ASSERT(sleep_ticks > 0);
-    ticks_to_sleep(sleep_ticks);
+    uint32_t count = msecond_to_ticks(msecond);
+    ASSERT(count > 0);
+    sleep_ticks(count);
+}
+
+void Timer::usleep(uint32_t usecond)
+{
+    constexpr uint32_t usecond_per_tick = 1000000 / IRQ0_FREQUENCY;
+    if (usecond == 0)
+    {
+        return;
+    }
+    if (!Clock::is_tsc_available())
+    {  //没有tsc时只能精确到嘀嗒
+        sleep_ticks(div_round_up(usecond, usecond_per_tick));
+        return;
+    }
+    /* 阻塞到剩余时间不超过USLEEP_SPIN_MAX_NS再自旋。第一个嘀嗒可能很快到来,sleep_ticks醒来时剩余的时间
+     * 仍可能较长,所以循环检查;不足一个嘀嗒但超过阈值时多阻塞一个嘀嗒,不在系统调用中长时间自旋 */
+    uint64_t deadline = Clock::now_ns() + (uint64_t)usecond * 1000;
+    while (true)
+    {
+        uint64_t now = Clock::now_ns();
+        if (now >= deadline)
+        {
+            return;
+        }
+        if (deadline - now <= USLEEP_SPIN_MAX_NS)
+        {
+            break;
+        }
+        sleep_ticks(max((uint32_t)div_u64(deadline - now, usecond_per_tick * 1000), 1U));
+    }
+    while (Clock::now_ns() < deadline)
+    {
+        cpu_relax();
+    }
 }
 
 /* 初始化PIT8253 */
@@ -73,6 +335,21 @@ void Timer::init()
     /* 设置8253的定时周期,也就是发中断的周期 */
     frequency_set(CONTRER0_PORT, COUNTER0_NO, READ_WRITE_LATCH, COUNTER_MODE, COUNTER0_VALUE);
     Interrupt::register_interrupt_handler(0x20, (InterruptHandler)timer_interrupt_handler);  //设置时钟中断
-    ticks = 0;
+    ticks              = 0;
+    quota_refill_ticks = 0;
+    one_shot_counts    = 0;
+    remainder_counts   = 0;
+    for (auto& slot : timer_wheel.tvr)
+    {
+        slot.init();
+    }
+    for (auto& level : timer_wheel.tvn)
+    {
+        for (auto& slot : level)
+        {
+            slot.init();
+        }
+    }
+    timer_wheel.timer_ticks = 0;
     printkln("timer init done");
 }
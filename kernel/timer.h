@@ -1,8 +1,43 @@
 #pragma once
+#include "kernel/list.h"
 #include "lib/stdint.h"
 
+#ifndef IRQ0_FREQUENCY
+#    define IRQ0_FREQUENCY 100  // 时钟中断的频率,编译时可通过-DIRQ0_FREQUENCY指定
+#endif
+static_assert(IRQ0_FREQUENCY >= 100 && IRQ0_FREQUENCY <= 1000 && 1000 % IRQ0_FREQUENCY == 0,
+              "IRQ0_FREQUENCY must be a divisor of 1000 between 100 and 1000");
+
+#define MSECOND_TO_TICKS(msecond) ((msecond)*IRQ0_FREQUENCY / 1000)
+
+using TimerCallback_t = void (*)(void* arg);
+
+//内核定时器,回调在时钟中断中执行,不能阻塞
+struct KernelTimer
+{
+    ListElement     tag;       // 所在时间轮槽的标记
+    uint32_t        expires;   // 到期时的嘀嗒数
+    uint32_t        period;    // 周期嘀嗒数,为0表示只触发一次
+    TimerCallback_t callback;  // 到期时调用的函数
+    void*           arg;       // callback的参数
+};
+
 namespace Timer
 {
     void init();
     void sleep(uint32_t msecond);
+    void sleep_ticks(uint32_t count);
+    //微秒级的sleep,按嘀嗒阻塞到剩余时间不超过1毫秒,最后的部分用tsc自旋等待
+    void     usleep(uint32_t usecond);
+    uint32_t get_ticks();
+    uint32_t msecond_to_ticks(uint32_t msecond);
+    void     init_timer(KernelTimer* timer, TimerCallback_t callback, void* arg);
+    //delay个嘀嗒后触发,period不为0时之后每period个嘀嗒触发一次
+    void add_timer(KernelTimer* timer, uint32_t delay, uint32_t period);
+    //取消未触发的定时器,定时器未启动时返回false
+    bool cancel_timer(KernelTimer* timer);
+    bool is_timer_pending(KernelTimer* timer);
+    //idle线程在hlt前后调用,没有临近的定时器时把时钟改为单次触发,减少空闲时的时钟中断
+    void enter_idle();
+    void exit_idle();
 }  // namespace Timer
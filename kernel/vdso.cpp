@@ -0,0 +1,87 @@
+#include "kernel/vdso.h"
+#include "kernel/asm_interface.h"
+#include "kernel/memory.h"
+#include "kernel/timer.h"
+#include "lib/debug.h"
+#include "lib/math.h"
+#include "lib/string.h"
+#include "thread/thread.h"
+
+#define PG_P_1 1   // 页表项或页目录项存在属性位
+#define PG_RW_R 0  // R/W 属性位值, 读/执行
+#define PG_RW_W 2  // R/W 属性位值, 读/写/执行
+#define PG_US_U 4  // U/S 属性位值, 用户级
+#define PDE_INDEX(addr) (((addr)&0xffc00000) >> 22)
+#define PTE_INDEX(addr) (((addr)&0x003ff000) >> 12)
+
+VdsoData* vdso_data;  // 共享数据页在内核中的可写地址
+
+void Vdso::init()
+{
+    printkln("vdso init start");
+    vdso_data = (VdsoData*)Memory::malloc_kernel_page(1);
+    ASSERT(vdso_data != nullptr);
+    memset(vdso_data, 0, PAGE_SIZE);
+    vdso_data->ticks         = Timer::get_ticks();
+    vdso_data->tick_ns       = NSECONDS_PER_SECOND / IRQ0_FREQUENCY;
+    vdso_data->tsc_available = Clock::is_tsc_available();
+    Clock::get_tsc_conversion(&vdso_data->tsc_base, &vdso_data->tsc_mult, &vdso_data->tsc_shift);
+    printkln("vdso init done");
+}
+
+void Vdso::map(uint32_t* pgd, PCB* pcb)
+{
+    ASSERT(vdso_data != nullptr);
+    ASSERT(PDE_INDEX(VDSO_DATA_VADDR) == PDE_INDEX(VDSO_PROCESS_VADDR));
+    //两页共用一个页表,页表留在进程中,之后映射到同一4MB内的用户页也会使用它
+    uint32_t*        page_table   = (uint32_t*)Memory::malloc_kernel_page(1);
+    VdsoProcessData* process_data = (VdsoProcessData*)Memory::malloc_kernel_page(1);
+    ASSERT(page_table != nullptr && process_data != nullptr);
+    memset(page_table, 0, PAGE_SIZE);
+    memset(process_data, 0, PAGE_SIZE);
+    process_data->pid        = pcb->pid;
+    process_data->parent_pid = pcb->parent_pid;
+
+    //用户只能读,内核通过自己的映射写入
+    uint32_t data_phy_addr    = (uint32_t)Memory::get_phsical_address_by_virtual_address(vdso_data);
+    uint32_t process_phy_addr = (uint32_t)Memory::get_phsical_address_by_virtual_address(process_data);
+    uint32_t table_phy_addr   = (uint32_t)Memory::get_phsical_address_by_virtual_address(page_table);
+    page_table[PTE_INDEX(VDSO_DATA_VADDR)]    = data_phy_addr | PG_US_U | PG_RW_R | PG_P_1;
+    page_table[PTE_INDEX(VDSO_PROCESS_VADDR)] = process_phy_addr | PG_US_U | PG_RW_R | PG_P_1;
+    pgd[PDE_INDEX(VDSO_DATA_VADDR)]           = table_phy_addr | PG_US_U | PG_RW_W | PG_P_1;
+}
+
+void Vdso::update_ticks(uint32_t ticks)
+{
+    if (vdso_data != nullptr)
+    {
+        vdso_data->ticks = ticks;
+    }
+}
+
+int16_t vdso_getpid()
+{
+    return ((VdsoProcessData*)VDSO_PROCESS_VADDR)->pid;
+}
+
+uint32_t vdso_get_ticks()
+{
+    return ((VdsoData*)VDSO_DATA_VADDR)->ticks;
+}
+
+uint64_t vdso_now_ns()
+{
+    VdsoData* data = (VdsoData*)VDSO_DATA_VADDR;
+    if (data->tsc_available)
+    {
+        return mul_u64_u32_shr(rdtsc() - data->tsc_base, data->tsc_mult, data->tsc_shift);
+    }
+    return (uint64_t)data->ticks * data->tick_ns;
+}
+
+void vdso_clock_gettime(TimeSpec* time)
+{
+    uint32_t nanosecond = 0;
+    time->second        = (uint32_t)div_u64(vdso_now_ns(), NSECONDS_PER_SECOND, &nanosecond);
+    time->nanosecond    = nanosecond;
+}
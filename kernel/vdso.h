@@ -0,0 +1,44 @@
+#pragma once
+#include "kernel/clock.h"
+#include "lib/stdint.h"
+
+struct PCB;
+
+#define VDSO_DATA_VADDR 0x8046000     // 所有进程共享的数据页,紧挨在用户虚拟地址池之前
+#define VDSO_PROCESS_VADDR 0x8047000  // 每个进程私有的数据页
+
+//所有进程共享的只读数据,由内核更新
+struct VdsoData
+{
+    volatile uint32_t ticks;          // 与Timer::get_ticks相同
+    uint32_t          tick_ns;        // 一个嘀嗒的纳秒数
+    uint64_t          tsc_base;       // 以下与Clock中tsc的换算参数相同
+    uint32_t          tsc_mult;
+    uint32_t          tsc_shift;
+    bool              tsc_available;
+};
+
+//每个进程私有的只读数据,在创建页目录时填写,之后不再改变
+struct VdsoProcessData
+{
+    int16_t pid;
+    int16_t parent_pid;
+};
+
+/* 映射到每个用户进程的只读数据页,用户进程读取时间和pid不需要陷入内核,
+ * 两页都不在用户虚拟地址池中,不会被fork拷贝或被用户释放 */
+namespace Vdso
+{
+    //在Clock和Memory初始化之后调用
+    void init();
+    //把共享数据页和新分配的私有数据页映射到页目录pgd中
+    void map(uint32_t* pgd, PCB* pcb);
+    //时钟中断中调用
+    void update_ticks(uint32_t ticks);
+}  // namespace Vdso
+
+//以下在用户态使用
+int16_t  vdso_getpid();
+uint32_t vdso_get_ticks();
+uint64_t vdso_now_ns();
+void     vdso_clock_gettime(TimeSpec* time);
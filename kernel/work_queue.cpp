@@ -0,0 +1,116 @@
+#include "kernel/work_queue.h"
+#include "kernel/interrupt.h"
+#include "kernel/memory.h"
+#include "kernel/timer.h"
+#include "lib/debug.h"
+#include "lib/string.h"
+#include "thread/run_queue.h"
+#include "thread/thread.h"
+
+WorkQueue  irq_work_queue;
+WorkQueue* work_queues[MAX_WORK_QUEUES];
+uint32_t   work_queue_count;
+
+Work* get_work_by_tag(ListElement* tag)
+{
+    return (Work*)((uint32_t)tag - (uint32_t) & ((Work*)0)->tag);
+}
+
+void WorkQueue::init(const char* name, uint8_t rt_priority)
+{
+    works.init();
+    idle = WaitQueue();
+    memset(&stats, 0, sizeof(WorkQueueStats));
+    ASSERT(strlen(name) < sizeof(stats.name));
+    strcpy(stats.name, name);
+    thread = Thread::create_thread(name, 31, worker, this);
+    if (rt_priority != 0)
+    {
+        Thread::set_scheduler(thread, SchedulePolicy::fifo, rt_priority);
+    }
+    AtomicGuard guard;
+    ASSERT(work_queue_count < MAX_WORK_QUEUES);
+    work_queues[work_queue_count++] = this;
+}
+
+void WorkQueue::init_work(Work* work, WorkCallback_t callback, void* arg)
+{
+    work->tag.init();
+    work->callback     = callback;
+    work->arg          = arg;
+    work->queued_ticks = 0;
+}
+
+bool WorkQueue::queue(Work* work)
+{
+    AtomicGuard guard;
+    if (work->tag.next != nullptr)
+    {  //还未执行的任务会处理这次的数据
+        stats.merged++;
+        return false;
+    }
+    work->queued_ticks = Timer::get_ticks();
+    works.push_back(work->tag);
+    stats.queued++;
+    stats.depth++;
+    if (stats.depth > stats.max_depth)
+    {
+        stats.max_depth = stats.depth;
+    }
+    idle.wake_one();
+    return true;
+}
+
+void WorkQueue::worker(void* arg)
+{
+    WorkQueue* queue = (WorkQueue*)arg;
+    while (true)
+    {
+        Work* work;
+        {
+            AtomicGuard guard;
+            while (queue->works.is_empty())
+            {
+                queue->idle.wait();
+            }
+            work = get_work_by_tag(queue->works.pop_front());
+            queue->stats.depth--;
+            uint32_t latency = Timer::get_ticks() - work->queued_ticks;
+            if (latency > queue->stats.max_latency)
+            {
+                queue->stats.max_latency = latency;
+            }
+        }
+        //出队后再执行,执行期间再次入队的任务会再执行一次
+        work->callback(work->arg);
+        queue->stats.executed++;
+    }
+}
+
+void WorkQueue::init_irq_queue()
+{
+    work_queue_count = 0;
+    irq_work_queue.init("irq_work", RT_PRIORITY_MAX);
+}
+
+WorkQueue* WorkQueue::get_irq_queue()
+{
+    return &irq_work_queue;
+}
+
+int32_t WorkQueue::get_stats(WorkQueueStats* stats, uint32_t count)
+{
+    //stats是用户传入的指针,必须整个落在当前进程已分配的用户内存中
+    if (stats == nullptr || count == 0 || count > 0xffffffffU / sizeof(WorkQueueStats) ||
+        !Memory::is_user_range_allocated(Thread::get_current_pcb(), (uint32_t)stats, count * sizeof(WorkQueueStats)))
+    {
+        return -1;
+    }
+    AtomicGuard guard;
+    uint32_t    size = count < work_queue_count ? count : work_queue_count;
+    for (uint32_t i = 0; i < size; i++)
+    {
+        stats[i] = work_queues[i]->stats;
+    }
+    return size;
+}
@@ -0,0 +1,56 @@
+#pragma once
+#include "kernel/list.h"
+#include "lib/stdint.h"
+#include "thread/sync.h"
+
+#define MAX_WORK_QUEUES 4  // 最多登记统计信息的工作队列数
+
+struct PCB;
+typedef void (*WorkCallback_t)(void* arg);
+
+//延后到工作线程中执行的任务,由调用者分配,执行前不能释放
+struct Work
+{
+    ListElement    tag;           // 所在工作队列的标记,不在队列中时next为nullptr
+    WorkCallback_t callback;      // 在工作线程中调用,此时中断是打开的
+    void*          arg;           // callback的参数
+    uint32_t       queued_ticks;  // 入队时的嘀嗒数,用于统计延迟
+};
+
+//工作队列的统计信息
+struct WorkQueueStats
+{
+    char     name[32];
+    uint32_t queued;       // 入队次数
+    uint32_t merged;       // 任务已在队列中,与上次合并的次数
+    uint32_t executed;     // 执行次数
+    uint32_t depth;        // 当前排队的任务数
+    uint32_t max_depth;    // 同时排队的最大任务数
+    uint32_t max_latency;  // 从入队到开始执行的最大嘀嗒数
+};
+
+/* 工作队列,中断处理函数只做应答并把任务入队,由工作线程执行其余的处理,
+ * 这样中断处理的时间不受具体工作影响,工作中也可以阻塞 */
+class WorkQueue
+{
+public:
+    //创建工作线程,rt_priority不为0时工作线程是该优先级的fifo实时线程
+    void init(const char* name, uint8_t rt_priority);
+    //可以在中断中调用,任务已在队列中时不重复加入,返回false
+    bool queue(Work* work);
+
+    static void init_work(Work* work, WorkCallback_t callback, void* arg);
+    //处理中断下半部的系统工作队列,工作线程是最高优先级的实时线程
+    static void       init_irq_queue();
+    static WorkQueue* get_irq_queue();
+    //复制最多count个工作队列的统计信息,返回复制的个数,stats不是当前进程已分配的用户内存时返回-1
+    static int32_t get_stats(WorkQueueStats* stats, uint32_t count);
+
+private:
+    static void worker(void* arg);
+
+    List           works;  // 等待执行的任务
+    WaitQueue      idle;   // 没有任务时工作线程在此等待
+    PCB*           thread;
+    WorkQueueStats stats;
+};
@@ -0,0 +1,188 @@
+#include "lib/fiber.h"
+#include "lib/stdlib.h"
+
+extern "C" void fiber_switch(Fiber* current, Fiber* next);
+
+Fiber* get_fiber_by_tag(ListElement* element)
+{
+    return (Fiber*)((uint32_t)element - (uint32_t) & ((Fiber*)0)->tag);
+}
+
+void FiberScheduler::init()
+{
+    main.tag.init();
+    main.scheduler = this;
+    running        = &main;
+    count          = 0;
+    ready.init();
+    died.init();
+}
+
+//新纤程第一次被fiber_switch切换到时从这里开始执行
+void fiber_entry(Fiber* fiber)
+{
+    fiber->scheduler->release_died();
+    fiber->function(fiber->arg);
+    fiber->scheduler->exit_current();
+}
+
+Fiber* FiberScheduler::spawn(FiberFunction_t function, void* arg)
+{
+    Fiber* fiber = (Fiber*)malloc(FIBER_STACK_SIZE);
+    if (fiber == nullptr)
+    {
+        return nullptr;
+    }
+    fiber->tag.init();
+    fiber->function  = function;
+    fiber->arg       = arg;
+    fiber->scheduler = this;
+    //栈顶依次是fiber_switch弹出的ebp,ebx,edi,esi,返回地址fiber_entry,fiber_entry的返回地址和参数
+    uint32_t* top = (uint32_t*)((uint32_t)fiber + FIBER_STACK_SIZE);
+    top -= 7;
+    top[0]     = 0;
+    top[1]     = 0;
+    top[2]     = 0;
+    top[3]     = 0;
+    top[4]     = (uint32_t)&fiber_entry;
+    top[5]     = 0;
+    top[6]     = (uint32_t)fiber;
+    fiber->esp = top;
+    ready.push_back(fiber->tag);
+    count++;
+    return fiber;
+}
+
+void FiberScheduler::release_died()
+{
+    while (!died.is_empty())
+    {
+        free(get_fiber_by_tag(died.pop_front()));
+    }
+}
+
+void FiberScheduler::switch_to_next()
+{
+    Fiber* current = running;
+    running        = get_fiber_by_tag(ready.pop_front());
+    fiber_switch(current, running);
+    release_died();
+}
+
+uint32_t FiberScheduler::run()
+{
+    //主纤程一直在就绪链表中轮转,就绪链表为空说明其余纤程都已结束或都在阻塞
+    while (!ready.is_empty())
+    {
+        yield();
+    }
+    return count;
+}
+
+void FiberScheduler::yield()
+{
+    if (ready.is_empty())
+    {
+        return;
+    }
+    ready.push_back(running->tag);
+    switch_to_next();
+}
+
+void FiberScheduler::block(List& waiters)
+{
+    waiters.push_back(running->tag);
+    switch_to_next();
+}
+
+bool FiberScheduler::wake_one(List& waiters)
+{
+    if (waiters.is_empty())
+    {
+        return false;
+    }
+    ready.push_back(waiters.pop_front());
+    return true;
+}
+
+void FiberScheduler::exit_current()
+{
+    //不能在自己的栈上释放自己,由下一个运行的纤程释放
+    died.push_back(running->tag);
+    count--;
+    switch_to_next();
+}
+
+void FiberScheduler::wait_io()
+{
+    if (ready.is_empty() || (ready.get_length() == 1 && &ready.front() == &main.tag))
+    {
+        yeild();
+    }
+    yield();
+}
+
+int32_t FiberScheduler::read(int32_t fd, void* buffer, uint32_t count)
+{
+    while (true)
+    {
+        int32_t result = read_nonblock(fd, buffer, count);
+        if (result != 0 || count == 0)
+        {
+            return result;
+        }
+        wait_io();
+    }
+}
+
+int32_t FiberScheduler::write(int32_t fd, const void* buffer, uint32_t count)
+{
+    uint32_t written = 0;
+    while (written < count)
+    {
+        int32_t result = write_nonblock(fd, (const char*)buffer + written, count - written);
+        if (result < 0)
+        {
+            return result;
+        }
+        written += result;
+        if (written < count)
+        {
+            wait_io();
+        }
+    }
+    return written;
+}
+
+void FiberChannel::init(FiberScheduler* scheduler)
+{
+    this->scheduler = scheduler;
+    head            = 0;
+    size            = 0;
+    senders.init();
+    receivers.init();
+}
+
+void FiberChannel::send(void* message)
+{
+    while (size == FIBER_CHANNEL_CAPACITY)
+    {
+        scheduler->block(senders);
+    }
+    buffer[(head + size) % FIBER_CHANNEL_CAPACITY] = message;
+    size++;
+    scheduler->wake_one(receivers);
+}
+
+void* FiberChannel::receive()
+{
+    while (size == 0)
+    {
+        scheduler->block(receivers);
+    }
+    void* message = buffer[head];
+    head          = (head + 1) % FIBER_CHANNEL_CAPACITY;
+    size--;
+    scheduler->wake_one(senders);
+    return message;
+}
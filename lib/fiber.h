@@ -0,0 +1,76 @@
+#pragma once
+#include "kernel/list.h"
+#include "lib/stdint.h"
+
+#define FIBER_STACK_SIZE 4000      // 包括Fiber自身,加上堆的头部不超过一页
+#define FIBER_CHANNEL_CAPACITY 16  // 通道中最多缓存的消息数
+
+typedef void (*FiberFunction_t)(void* arg);
+
+class FiberScheduler;
+
+//用户态纤程,在所属线程内协作式调度,切换时不进入内核
+struct Fiber
+{
+    uint32_t*       esp;  // 切换时保存的栈顶指针,fiber_switch要求它是第一个成员
+    ListElement     tag;  // 在就绪链表、等待链表或死亡链表中
+    FiberFunction_t function;
+    void*           arg;
+    FiberScheduler* scheduler;
+};
+
+/* 在一个线程内复用多个纤程的调度器,必须放在用户栈或用户堆中,
+ * 因为用户程序和内核链接在一起,全局变量被所有进程共享.
+ * 创建调度器的线程作为主纤程,只应调用run,不应阻塞在通道上 */
+class FiberScheduler
+{
+public:
+    void init();
+    //创建纤程并放入就绪链表,内存不足时返回nullptr
+    Fiber* spawn(FiberFunction_t function, void* arg);
+    //运行直到所有纤程结束,返回仍在阻塞的纤程数,不为0说明发生了死锁
+    uint32_t run();
+    //让出cpu给下一个就绪的纤程,没有其它就绪纤程时直接返回
+    void yield();
+    //把当前纤程放入waiters并切换到下一个纤程
+    void block(List& waiters);
+    //唤醒waiters中的一个纤程,没有等待者时返回false
+    bool wake_one(List& waiters);
+    //结束当前纤程,不会返回
+    void exit_current();
+    //不阻塞整个线程的读写,数据未就绪时让出cpu给其它纤程
+    int32_t read(int32_t fd, void* buffer, uint32_t count);
+    int32_t write(int32_t fd, const void* buffer, uint32_t count);
+
+private:
+    void switch_to_next();
+    void release_died();
+    //没有其它就绪纤程时让出整个线程的时间片,否则切换到其它纤程
+    void wait_io();
+
+    friend void fiber_entry(Fiber* fiber);
+
+private:
+    Fiber    main;     // 调用run的线程自身
+    Fiber*   running;  // 正在运行的纤程
+    List     ready;    // 就绪的纤程
+    List     died;     // 已结束但栈还未释放的纤程
+    uint32_t count;    // 未结束的纤程数,不包括主纤程
+};
+
+//纤程间传递消息的有界通道,满时发送者阻塞,空时接收者阻塞
+class FiberChannel
+{
+public:
+    void  init(FiberScheduler* scheduler);
+    void  send(void* message);
+    void* receive();
+
+private:
+    FiberScheduler* scheduler;
+    void*           buffer[FIBER_CHANNEL_CAPACITY];
+    uint32_t        head;
+    uint32_t        size;
+    List            senders;    // 等待通道有空位的纤程
+    List            receivers;  // 等待通道有消息的纤程
+};
@@ -0,0 +1,20 @@
+[bits 32]
+section .text
+global fiber_switch
+fiber_switch:
+   ;与switch_to相同,只是在用户态切换,不进入内核
+   push esi
+   push edi
+   push ebx
+   push ebp
+
+   mov eax, [esp + 20]           ; 参数current
+   mov [eax], esp                ; 保存栈顶指针,esp在Fiber中的偏移为0
+   mov eax, [esp + 24]           ; 参数next
+   mov esp, [eax]                ; 恢复next的栈顶指针
+
+   pop ebp
+   pop ebx
+   pop edi
+   pop esi
+   ret                           ; 新纤程第一次执行时返回到fiber_entry
@@ -3,4 +3,33 @@
 uint32_t div_round_up(uint32_t a, uint32_t b)
 {
     return (a + b - 1) / b;
-}
\ No newline at end of file
+}
+
+uint64_t div_u64(uint64_t dividend, uint32_t divisor, uint32_t* remainder)
+{
+    //先除高32位,余数作为第二次divl的高32位,保证商不超过32位
+    uint32_t high          = (uint32_t)(dividend >> 32);
+    uint32_t low           = (uint32_t)dividend;
+    uint32_t quotient_high = high / divisor;
+    uint32_t quotient_low  = 0;
+    uint32_t rest          = 0;
+    high %= divisor;
+    asm("divl %4" : "=a"(quotient_low), "=d"(rest) : "a"(low), "d"(high), "rm"(divisor));
+    if (remainder != nullptr)
+    {
+        *remainder = rest;
+    }
+    return ((uint64_t)quotient_high << 32) | quotient_low;
+}
+
+uint64_t mul_u64_u32_shr(uint64_t a, uint32_t mul, uint32_t shift)
+{
+    uint32_t high   = (uint32_t)(a >> 32);
+    uint32_t low    = (uint32_t)a;
+    uint64_t result = ((uint64_t)low * mul) >> shift;
+    if (high != 0)
+    {
+        result += ((uint64_t)high * mul) << (32 - shift);
+    }
+    return result;
+}
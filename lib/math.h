@@ -3,6 +3,10 @@
 #include "lib/stdint.h"
 
 uint32_t div_round_up(uint32_t a, uint32_t b);
+//64位整数除以32位整数,没有libgcc,不能直接使用64位除法
+uint64_t div_u64(uint64_t dividend, uint32_t divisor, uint32_t* remainder = nullptr);
+//计算(a * mul) >> shift,shift不大于32,中间结果不会溢出
+uint64_t mul_u64_u32_shr(uint64_t a, uint32_t mul, uint32_t shift);
 
 template <typename T>
 const T& max(const T& left, const T& right)
@@ -9,8 +9,20 @@ void free(void* p)
 {
     return Systemcall::free(p);
 }
+//用户进程映射了vdso数据页,直接读取,不需要系统调用
+inline bool is_vdso_usable()
+{
+    uint16_t cs;
+    asm("movw %%cs, %0" : "=r"(cs));
+    return (cs & 3) == 3;
+}
+
 int16_t getpid()
 {
+    if (is_vdso_usable())
+    {
+        return vdso_getpid();
+    }
     return Systemcall::getpid();
 }
 
@@ -42,4 +54,132 @@ int32_t read(int32_t fd, void* buffer, uint32_t count)
 int32_t write(int32_t fd, const void* buffer, uint32_t count)
 {
     return Systemcall::write(fd, buffer, count);
-}
\ No newline at end of file
+}
+
+int32_t madvise(void* address, uint32_t length, MemoryAdvice advice)
+{
+    return Systemcall::madvise(address, length, advice);
+}
+
+void set_page_merge(bool enable)
+{
+    Systemcall::set_page_merge(enable);
+}
+
+void get_page_merge_state(PageMergeState* state)
+{
+    Systemcall::get_page_merge_state(state);
+}
+
+int32_t setrlimit(pid_t pid, ResourceType type, uint32_t limit)
+{
+    return Systemcall::setrlimit(pid, type, limit);
+}
+
+uint32_t getrlimit(pid_t pid, ResourceType type)
+{
+    return Systemcall::getrlimit(pid, type);
+}
+
+int32_t getrusage(pid_t pid, ResourceUsage* usage)
+{
+    return Systemcall::getrusage(pid, usage);
+}
+
+int32_t sched_setscheduler(pid_t pid, SchedulePolicy policy, uint8_t rt_priority)
+{
+    return Systemcall::sched_setscheduler(pid, policy, rt_priority);
+}
+
+int32_t clock_gettime(TimeSpec* time)
+{
+    if (time != nullptr && is_vdso_usable())
+    {
+        vdso_clock_gettime(time);
+        return 0;
+    }
+    return Systemcall::clock_gettime(time);
+}
+
+void usleep(uint32_t usecond)
+{
+    Systemcall::usleep(usecond);
+}
+
+int32_t ps(ThreadInfo* info, uint32_t count)
+{
+    return Systemcall::ps(info, count);
+}
+
+IoRing* io_ring_setup(uint32_t entries)
+{
+    return Systemcall::io_ring_setup(entries);
+}
+
+int32_t io_ring_enter(uint32_t to_submit)
+{
+    return Systemcall::io_ring_enter(to_submit);
+}
+
+uint32_t get_ticks()
+{
+    if (is_vdso_usable())
+    {
+        return vdso_get_ticks();
+    }
+    return Timer::get_ticks();
+}
+
+int32_t futex_wait(volatile uint32_t* address, uint32_t expected, uint32_t msecond)
+{
+    return Systemcall::futex_wait(address, expected, msecond);
+}
+
+int32_t futex_wake(volatile uint32_t* address, uint32_t count)
+{
+    return Systemcall::futex_wake(address, count);
+}
+
+//clone出的线程在用户态的入口,函数返回后结束线程
+void user_thread_entry(ThreadCallbackFunction_t function, void* arg)
+{
+    function(arg);
+    Systemcall::thread_exit();
+}
+
+int16_t thread_create(ThreadCallbackFunction_t function, void* arg, void* tls)
+{
+    //线程结束时仍在使用自己的栈,所以栈不释放
+    uint8_t* stack = (uint8_t*)malloc(USER_THREAD_STACK_SIZE);
+    if (stack == nullptr)
+    {
+        return -1;
+    }
+    CloneArgs args = {user_thread_entry, function, arg, stack + USER_THREAD_STACK_SIZE, (uint32_t)tls};
+    pid_t     pid  = Systemcall::clone(&args);
+    if (pid == -1)
+    {
+        free(stack);
+    }
+    return pid;
+}
+
+void thread_exit()
+{
+    Systemcall::thread_exit();
+}
+
+int32_t read_nonblock(int32_t fd, void* buffer, uint32_t count)
+{
+    return Systemcall::read_nonblock(fd, buffer, count);
+}
+
+int32_t write_nonblock(int32_t fd, const void* buffer, uint32_t count)
+{
+    return Systemcall::write_nonblock(fd, buffer, count);
+}
+
+int32_t work_queue_stats(WorkQueueStats* stats, uint32_t count)
+{
+    return Systemcall::work_queue_stats(stats, count);
+}
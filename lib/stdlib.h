@@ -1,12 +1,43 @@
 #pragma once
+#include "kernel/clock.h"
+#include "kernel/futex.h"
+#include "kernel/io_ring.h"
+#include "kernel/memory.h"
+#include "kernel/vdso.h"
+#include "kernel/work_queue.h"
 #include "lib/stdio.h"
+#include "process/process.h"
+#include "process/resource.h"
+#include "thread/thread.h"
 
-void*   malloc(uint32_t size);
-void    free(void* p);
-int16_t getpid();
-void    yeild();
-void    sleep(uint32_t m_interval);
-int16_t fork();
-int32_t pipe(int32_t fd[2]);
-int32_t read(int32_t fd, void* buffer, uint32_t count);
-int32_t write(int32_t fd, const void* buffer, uint32_t count);
\ No newline at end of file
+void*    malloc(uint32_t size);
+void     free(void* p);
+int16_t  getpid();
+void     yeild();
+void     sleep(uint32_t m_interval);
+int16_t  fork();
+int32_t  pipe(int32_t fd[2]);
+int32_t  read(int32_t fd, void* buffer, uint32_t count);
+int32_t  write(int32_t fd, const void* buffer, uint32_t count);
+int32_t  madvise(void* address, uint32_t length, MemoryAdvice advice);
+void     set_page_merge(bool enable);
+void     get_page_merge_state(PageMergeState* state);
+int32_t  setrlimit(int16_t pid, ResourceType type, uint32_t limit);
+uint32_t getrlimit(int16_t pid, ResourceType type);
+int32_t  getrusage(int16_t pid, ResourceUsage* usage);
+int32_t  sched_setscheduler(int16_t pid, SchedulePolicy policy, uint8_t rt_priority);
+int32_t  clock_gettime(TimeSpec* time);
+void     usleep(uint32_t usecond);
+int32_t  ps(ThreadInfo* info, uint32_t count);
+IoRing*  io_ring_setup(uint32_t entries);
+int32_t  io_ring_enter(uint32_t to_submit);
+uint32_t get_ticks();
+int32_t  futex_wait(volatile uint32_t* address, uint32_t expected, uint32_t msecond);
+int32_t  futex_wake(volatile uint32_t* address, uint32_t count);
+//创建与当前进程共享地址空间的线程,tls不为nullptr时作为线程局部存储段的基址,返回线程的pid
+int16_t  thread_create(ThreadCallbackFunction_t function, void* arg, void* tls);
+void     thread_exit();
+int32_t  read_nonblock(int32_t fd, void* buffer, uint32_t count);
+int32_t  write_nonblock(int32_t fd, const void* buffer, uint32_t count);
+//复制最多count个内核工作队列的统计信息,返回复制的个数
+int32_t  work_queue_stats(WorkQueueStats* stats, uint32_t count);
\ No newline at end of file
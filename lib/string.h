@@ -4,6 +4,7 @@
 
 void     memset(void* dest, uint8_t value, uint32_t size);
 void     memcpy(void* dest, const void* src, uint32_t size);
+int      memcmp(const void* str1, const void* str2, uint32_t size);
 char*    strcpy(char* dest, const char* src);
 uint32_t strlen(const char* str);
 int      strcmp(const char* str1, const char* str2);
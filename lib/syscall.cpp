@@ -3,12 +3,17 @@
 // #include "kernel/print.h"
 #include "disk/file_system.h"
 #include "kernel/asm_interface.h"
+#include "kernel/clock.h"
+#include "kernel/futex.h"
+#include "kernel/io_ring.h"
 #include "kernel/timer.h"
+#include "kernel/work_queue.h"
 #include "lib/debug.h"
 #include "lib/stdint.h"
 #include "lib/stdio.h"
 #include "lib/string.h"
 #include "process/process.h"
+#include "process/tss.h"
 
 typedef void* Syscall_t;
 
@@ -44,16 +49,57 @@ enum class SystemcallType : uint32_t
     help,
     yield,
     sleep,
+    madvise,
+    set_page_merge,
+    get_page_merge_state,
+    setrlimit,
+    getrlimit,
+    getrusage,
+    sched_setscheduler,
+    clock_gettime,
+    usleep,
+    io_ring_setup,
+    io_ring_enter,
+    futex_wait,
+    futex_wake,
+    clone,
+    thread_exit,
+    read_nonblock,
+    write_nonblock,
+    work_queue_stats,
     max,
 };
 
 Syscall_t syscall_table[(uint32_t)SystemcallType::max];
 
+bool use_sysenter;  // 处理器支持sysenter时由内核设置,用户态可以读取
+
+//只有用户态才能使用sysenter,sysexit总是返回到特权级3
+inline bool is_sysenter_usable()
+{
+    uint16_t cs;
+    asm("movw %%cs, %0" : "=r"(cs));
+    return use_sysenter && (cs & 3) == 3;
+}
+
+/* 通过sysenter进入内核,edi为返回地址,ebp为用户栈,返回时ecx和edx会被破坏 */
+#define _sysenter(retval, NUMBER, ARG1, ARG2, ARG3)                                                                    \
+    ({                                                                                                                 \
+        uint32_t __arg2 = (uint32_t)(ARG2), __arg3 = (uint32_t)(ARG3);                                                 \
+        asm volatile("push %%ebp; movl %%esp, %%ebp; movl $1f, %%edi; sysenter; 1: pop %%ebp"                          \
+                     : "=a"(retval), "+c"(__arg2), "+d"(__arg3)                                                        \
+                     : "a"(NUMBER), "b"(ARG1)                                                                          \
+                     : "edi", "memory");                                                                               \
+    })
+
 /* 无参数的系统调用 */
 #define _syscall0(NUMBER)                                                                                              \
     ({                                                                                                                 \
         int retval;                                                                                                    \
-        asm volatile("int $0x80" : "=a"(retval) : "a"(NUMBER) : "memory");                                             \
+        if (is_sysenter_usable())                                                                                      \
+            _sysenter(retval, NUMBER, 0, 0, 0);                                                                        \
+        else                                                                                                           \
+            asm volatile("int $0x80" : "=a"(retval) : "a"(NUMBER) : "memory");                                         \
         retval;                                                                                                        \
     })
 
@@ -61,7 +107,10 @@ Syscall_t syscall_table[(uint32_t)SystemcallType::max];
 #define _syscall1(NUMBER, ARG1)                                                                                        \
     ({                                                                                                                 \
         int retval;                                                                                                    \
-        asm volatile("int $0x80" : "=a"(retval) : "a"(NUMBER), "b"(ARG1) : "memory");                                  \
+        if (is_sysenter_usable())                                                                                      \
+            _sysenter(retval, NUMBER, ARG1, 0, 0);                                                                     \
+        else                                                                                                           \
+            asm volatile("int $0x80" : "=a"(retval) : "a"(NUMBER), "b"(ARG1) : "memory");                              \
         retval;                                                                                                        \
     })
 
@@ -69,7 +118,10 @@ Syscall_t syscall_table[(uint32_t)SystemcallType::max];
 #define _syscall2(NUMBER, ARG1, ARG2)                                                                                  \
     ({                                                                                                                 \
         int retval;                                                                                                    \
-        asm volatile("int $0x80" : "=a"(retval) : "a"(NUMBER), "b"(ARG1), "c"(ARG2) : "memory");                       \
+        if (is_sysenter_usable())                                                                                      \
+            _sysenter(retval, NUMBER, ARG1, ARG2, 0);                                                                  \
+        else                                                                                                           \
+            asm volatile("int $0x80" : "=a"(retval) : "a"(NUMBER), "b"(ARG1), "c"(ARG2) : "memory");                   \
         retval;                                                                                                        \
     })
 
@@ -77,7 +129,10 @@ Syscall_t syscall_table[(uint32_t)SystemcallType::max];
 #define _syscall3(NUMBER, ARG1, ARG2, ARG3)                                                                            \
     ({                                                                                                                 \
         int retval;                                                                                                    \
-        asm volatile("int $0x80" : "=a"(retval) : "a"(NUMBER), "b"(ARG1), "c"(ARG2), "d"(ARG3) : "memory");            \
+        if (is_sysenter_usable())                                                                                      \
+            _sysenter(retval, NUMBER, ARG1, ARG2, ARG3);                                                               \
+        else                                                                                                           \
+            asm volatile("int $0x80" : "=a"(retval) : "a"(NUMBER), "b"(ARG1), "c"(ARG2), "d"(ARG3) : "memory");        \
         retval;                                                                                                        \
     })
 
@@ -87,9 +142,10 @@ pid_t Systemcall::getpid()
     return _syscall0(SystemcallType::getpid);
 }
 
+//clone出的线程返回所属进程的pid,与vdso中的getpid一致
 static pid_t getpid()
 {
-    return Thread::get_current_pcb()->pid;
+    return Thread::get_current_pcb()->process->pid;
 }
 
 uint32_t write(const char* str)
@@ -138,18 +194,133 @@ int32_t Systemcall::write(int32_t fd, const void* buffer, uint32_t count)
     return _syscall3(SystemcallType::write, fd, buffer, count);
 }
 
+int32_t Systemcall::madvise(void* address, uint32_t length, MemoryAdvice advice)
+{
+    return _syscall3(SystemcallType::madvise, address, length, advice);
+}
+
+void Systemcall::set_page_merge(bool enable)
+{
+    _syscall1(SystemcallType::set_page_merge, enable);
+}
+
+void Systemcall::get_page_merge_state(PageMergeState* state)
+{
+    _syscall1(SystemcallType::get_page_merge_state, state);
+}
+
+int32_t Systemcall::setrlimit(pid_t pid, ResourceType type, uint32_t limit)
+{
+    return _syscall3(SystemcallType::setrlimit, pid, type, limit);
+}
+
+uint32_t Systemcall::getrlimit(pid_t pid, ResourceType type)
+{
+    return _syscall2(SystemcallType::getrlimit, pid, type);
+}
+
+int32_t Systemcall::getrusage(pid_t pid, ResourceUsage* usage)
+{
+    return _syscall2(SystemcallType::getrusage, pid, usage);
+}
+
+int32_t Systemcall::sched_setscheduler(pid_t pid, SchedulePolicy policy, uint8_t rt_priority)
+{
+    return _syscall3(SystemcallType::sched_setscheduler, pid, policy, rt_priority);
+}
+
+int32_t Systemcall::ps(ThreadInfo* info, uint32_t count)
+{
+    return _syscall2(SystemcallType::ps, info, count);
+}
+
+int32_t Systemcall::clock_gettime(TimeSpec* time)
+{
+    return _syscall1(SystemcallType::clock_gettime, time);
+}
+
+void Systemcall::usleep(uint32_t usecond)
+{
+    _syscall1(SystemcallType::usleep, usecond);
+}
+
+IoRing* Systemcall::io_ring_setup(uint32_t entries)
+{
+    return (IoRing*)_syscall1(SystemcallType::io_ring_setup, entries);
+}
+
+int32_t Systemcall::io_ring_enter(uint32_t to_submit)
+{
+    return _syscall1(SystemcallType::io_ring_enter, to_submit);
+}
+
+int32_t Systemcall::futex_wait(volatile uint32_t* address, uint32_t expected, uint32_t msecond)
+{
+    return _syscall3(SystemcallType::futex_wait, address, expected, msecond);
+}
+
+int32_t Systemcall::futex_wake(volatile uint32_t* address, uint32_t count)
+{
+    return _syscall2(SystemcallType::futex_wake, address, count);
+}
+
+pid_t Systemcall::clone(const CloneArgs* args)
+{
+    return _syscall1(SystemcallType::clone, args);
+}
+
+void Systemcall::thread_exit()
+{
+    _syscall0(SystemcallType::thread_exit);
+}
+
+int32_t Systemcall::read_nonblock(int32_t fd, void* buffer, uint32_t count)
+{
+    return _syscall3(SystemcallType::read_nonblock, fd, buffer, count);
+}
+
+int32_t Systemcall::write_nonblock(int32_t fd, const void* buffer, uint32_t count)
+{
+    return _syscall3(SystemcallType::write_nonblock, fd, buffer, count);
+}
+
+int32_t Systemcall::work_queue_stats(WorkQueueStats* stats, uint32_t count)
+{
+    return _syscall2(SystemcallType::work_queue_stats, stats, count);
+}
+
 void Systemcall::init()
 {
     printkln("systcall_init start");
-    syscall_table[(uint32_t)SystemcallType::getpid] = (Syscall_t) & ::getpid;
-    syscall_table[(uint32_t)SystemcallType::malloc] = (Syscall_t)&Memory::malloc;
-    syscall_table[(uint32_t)SystemcallType::free]   = (Syscall_t)&Memory::free;
-    syscall_table[(uint32_t)SystemcallType::yield]  = (Syscall_t)&Thread::yield;
-    syscall_table[(uint32_t)SystemcallType::sleep]  = (Syscall_t)&Timer::sleep;
-    syscall_table[(uint32_t)SystemcallType::fork]   = (Syscall_t)&Process::fork;
-    syscall_table[(uint32_t)SystemcallType::read]   = (Syscall_t)&FileSystem::read;
-    syscall_table[(uint32_t)SystemcallType::pipe]   = (Syscall_t)&FileSystem::pipe;
-    syscall_table[(uint32_t)SystemcallType::write]  = (Syscall_t)&FileSystem::write;
+    use_sysenter = TSS::is_sysenter_enabled();
+    syscall_table[(uint32_t)SystemcallType::getpid]               = (Syscall_t) & ::getpid;
+    syscall_table[(uint32_t)SystemcallType::malloc]               = (Syscall_t)&Memory::malloc;
+    syscall_table[(uint32_t)SystemcallType::free]                 = (Syscall_t)&Memory::free;
+    syscall_table[(uint32_t)SystemcallType::yield]                = (Syscall_t)&Thread::yield;
+    syscall_table[(uint32_t)SystemcallType::sleep]                = (Syscall_t)&Timer::sleep;
+    syscall_table[(uint32_t)SystemcallType::fork]                 = (Syscall_t)&Process::fork;
+    syscall_table[(uint32_t)SystemcallType::read]                 = (Syscall_t)&FileSystem::read;
+    syscall_table[(uint32_t)SystemcallType::pipe]                 = (Syscall_t)&FileSystem::pipe;
+    syscall_table[(uint32_t)SystemcallType::write]                = (Syscall_t)&FileSystem::write;
+    syscall_table[(uint32_t)SystemcallType::madvise]              = (Syscall_t)&Memory::madvise;
+    syscall_table[(uint32_t)SystemcallType::set_page_merge]       = (Syscall_t)&Memory::set_page_merge;
+    syscall_table[(uint32_t)SystemcallType::get_page_merge_state] = (Syscall_t)&Memory::get_page_merge_state;
+    syscall_table[(uint32_t)SystemcallType::setrlimit]            = (Syscall_t)&Resource::setrlimit;
+    syscall_table[(uint32_t)SystemcallType::getrlimit]            = (Syscall_t)&Resource::getrlimit;
+    syscall_table[(uint32_t)SystemcallType::getrusage]            = (Syscall_t)&Resource::getrusage;
+    syscall_table[(uint32_t)SystemcallType::sched_setscheduler]   = (Syscall_t)&Thread::sched_setscheduler;
+    syscall_table[(uint32_t)SystemcallType::ps]                   = (Syscall_t)&Thread::ps;
+    syscall_table[(uint32_t)SystemcallType::clock_gettime]        = (Syscall_t)&Clock::clock_gettime;
+    syscall_table[(uint32_t)SystemcallType::usleep]               = (Syscall_t)&Timer::usleep;
+    syscall_table[(uint32_t)SystemcallType::io_ring_setup]        = (Syscall_t)&Ring::setup;
+    syscall_table[(uint32_t)SystemcallType::io_ring_enter]        = (Syscall_t)&Ring::enter;
+    syscall_table[(uint32_t)SystemcallType::futex_wait]           = (Syscall_t)&Futex::wait;
+    syscall_table[(uint32_t)SystemcallType::futex_wake]           = (Syscall_t)&Futex::wake;
+    syscall_table[(uint32_t)SystemcallType::clone]                = (Syscall_t)&Process::clone;
+    syscall_table[(uint32_t)SystemcallType::thread_exit]          = (Syscall_t)&Thread::exit_current_thread;
+    syscall_table[(uint32_t)SystemcallType::read_nonblock]        = (Syscall_t)&FileSystem::read_nonblock;
+    syscall_table[(uint32_t)SystemcallType::write_nonblock]       = (Syscall_t)&FileSystem::write_nonblock;
+    syscall_table[(uint32_t)SystemcallType::work_queue_stats]     = (Syscall_t)&WorkQueue::get_stats;
 
     printkln("systcall_init done");
 }
\ No newline at end of file
@@ -1,6 +1,10 @@
 #pragma once
 
+#include "kernel/clock.h"
+#include "kernel/io_ring.h"
+#include "kernel/work_queue.h"
 #include "lib/stdint.h"
+#include "process/process.h"
 #include "thread/thread.h"
 
 namespace Systemcall
@@ -26,7 +30,7 @@ namespace Systemcall
     void              rewinddir(struct dir* dir);
     // int32_t           stat(const char* path, struct stat* buf);
     int32_t chdir(const char* path);
-    void    ps(void);
+    int32_t ps(ThreadInfo* info, uint32_t count);
     int32_t execv(const char* pathname, char** argv);
     void    exit(int32_t status);
     pid_t   wait(int32_t* status);
@@ -36,4 +40,23 @@ namespace Systemcall
     void    init();
     void    yield();
     void    sleep(uint32_t m_interval);
+    int32_t madvise(void* address, uint32_t length, MemoryAdvice advice);
+    void    set_page_merge(bool enable);
+    void    get_page_merge_state(PageMergeState* state);
+    //pid为0表示当前进程
+    int32_t  setrlimit(pid_t pid, ResourceType type, uint32_t limit);
+    uint32_t getrlimit(pid_t pid, ResourceType type);
+    int32_t  getrusage(pid_t pid, ResourceUsage* usage);
+    int32_t  sched_setscheduler(pid_t pid, SchedulePolicy policy, uint8_t rt_priority);
+    int32_t  clock_gettime(TimeSpec* time);
+    void     usleep(uint32_t usecond);
+    IoRing*  io_ring_setup(uint32_t entries);
+    int32_t  io_ring_enter(uint32_t to_submit);
+    int32_t  futex_wait(volatile uint32_t* address, uint32_t expected, uint32_t msecond);
+    int32_t  futex_wake(volatile uint32_t* address, uint32_t count);
+    pid_t    clone(const CloneArgs* args);
+    void     thread_exit();
+    int32_t  read_nonblock(int32_t fd, void* buffer, uint32_t count);
+    int32_t  write_nonblock(int32_t fd, const void* buffer, uint32_t count);
+    int32_t  work_queue_stats(WorkQueueStats* stats, uint32_t count);
 }  // namespace Systemcall
\ No newline at end of file
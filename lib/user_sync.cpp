@@ -0,0 +1,69 @@
+#include "lib/user_sync.h"
+#include "kernel/asm_interface.h"
+#include "lib/stdlib.h"
+
+#define MUTEX_UNLOCKED 0
+#define MUTEX_LOCKED 1
+#define MUTEX_CONTENDED 2
+
+void UserMutex::lock()
+{
+    uint32_t old = atomic_compare_exchange(&state, MUTEX_UNLOCKED, MUTEX_LOCKED);
+    if (old == MUTEX_UNLOCKED)
+    {
+        return;
+    }
+    //有竞争,标记为有等待者后进入内核等待,解锁者会唤醒一个等待者
+    if (old != MUTEX_CONTENDED)
+    {
+        old = atomic_exchange(&state, MUTEX_CONTENDED);
+    }
+    while (old != MUTEX_UNLOCKED)
+    {
+        futex_wait(&state, MUTEX_CONTENDED, 0);
+        old = atomic_exchange(&state, MUTEX_CONTENDED);
+    }
+}
+
+bool UserMutex::try_lock()
+{
+    return atomic_compare_exchange(&state, MUTEX_UNLOCKED, MUTEX_LOCKED) == MUTEX_UNLOCKED;
+}
+
+void UserMutex::unlock()
+{
+    if (atomic_exchange(&state, MUTEX_UNLOCKED) == MUTEX_CONTENDED)
+    {
+        futex_wake(&state, 1);
+    }
+}
+
+bool UserCondition::wait(UserMutex& mutex, uint32_t msecond)
+{
+    uint32_t current = sequence;
+    atomic_fetch_add(&waiters, 1);
+    mutex.unlock();
+    //sequence在解锁后被修改时直接返回,不会错过唤醒
+    bool woken = futex_wait(&sequence, current, msecond) == 0 || sequence != current;
+    atomic_fetch_add(&waiters, (uint32_t)-1);
+    mutex.lock();
+    return woken;
+}
+
+void UserCondition::signal()
+{
+    atomic_fetch_add(&sequence, 1);
+    if (waiters != 0)
+    {
+        futex_wake(&sequence, 1);
+    }
+}
+
+void UserCondition::broadcast()
+{
+    atomic_fetch_add(&sequence, 1);
+    if (waiters != 0)
+    {
+        futex_wake(&sequence, FUTEX_WAKE_ALL);
+    }
+}
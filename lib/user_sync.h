@@ -0,0 +1,29 @@
+#pragma once
+#include "lib/stdint.h"
+
+/* 基于futex的用户态互斥锁,没有竞争时加锁解锁都不进入内核,
+ * 全局变量全为0时即为未加锁状态,不需要构造 */
+class UserMutex
+{
+public:
+    void lock();
+    bool try_lock();
+    void unlock();
+
+private:
+    volatile uint32_t state;  // 0为未加锁,1为加锁且没有等待者,2为加锁且可能有等待者
+};
+
+//基于futex的用户态条件变量,没有等待者时signal和broadcast不进入内核
+class UserCondition
+{
+public:
+    //释放mutex并等待,返回前重新获得mutex;msecond为0表示一直等待,超时返回false
+    bool wait(UserMutex& mutex, uint32_t msecond = 0);
+    void signal();
+    void broadcast();
+
+private:
+    volatile uint32_t sequence;  // 每次唤醒加1,等待者据此判断是否错过了唤醒
+    volatile uint32_t waiters;   // 正在等待的线程数
+};
@@ -1,10 +1,14 @@
 #include "process/process.h"
 #include "kernel/boot_config.h"
+#include "kernel/fpu.h"
 #include "kernel/interrupt.h"
+#include "kernel/vdso.h"
 #include "lib/debug.h"
 #include "lib/math.h"
 #include "lib/stdio.h"
+#include "process/resource.h"
 #include "process/tss.h"
+#include "thread/run_queue.h"
 #include "thread/sync.h"
 #include "thread/thread.h"
 
@@ -21,11 +25,9 @@
 extern "C" {
 void intr_exit();
 };
-/* 构建用户进程初始上下文信息 */
-void process_entry(void* filename)
+//在内核栈上构建返回用户态的中断栈,之后从intr_exit进入用户态
+InterruptStack* init_user_interrupt_stack(PCB* thread, void* eip, void* esp, uint32_t gs)
 {
-    void* function = filename;
-    PCB*  thread   = Thread::get_current_pcb();
     thread->self_kstack += sizeof(ThreadStack);  //跳过thread stack
     InterruptStack* stack = (InterruptStack*)thread->self_kstack;
     stack->edi            = 0;
@@ -36,22 +38,49 @@ void process_entry(void* filename)
     stack->edx            = 0;
     stack->ecx            = 0;
     stack->eax            = 0;
-    stack->gs             = 0;
+    stack->gs             = gs;
     stack->ds             = SELECTOR_U_DATA;
     stack->es             = SELECTOR_U_DATA;
     stack->fs             = SELECTOR_U_DATA;
-    stack->eip            = (decltype(stack->eip))function;
+    stack->eip            = (decltype(stack->eip))eip;
     stack->cs             = SELECTOR_U_CODE;
     // stack->cs = SELECTOR_K_CODE;  //为了调试方便，让用户程序能运行内核代码
     // printk_debug("debug setting: user can run kernel code\n");
     stack->eflags = EFLAGS_IOPL_0 | EFLAGS_MBS | EFLAGS_IF_1;
+    stack->esp    = esp;
+    stack->ss     = SELECTOR_U_DATA;
+    return stack;
+}
+
+/* 构建用户进程初始上下文信息 */
+void process_entry(void* filename)
+{
+    PCB* thread = Thread::get_current_pcb();
     //为用户内核栈分配内存
     Memory::malloc_physical_page_for_virtual_page(false, (void*)USER_STACK3_VADDR);
-    stack->esp = (void*)(USER_STACK3_VADDR + PAGE_SIZE);
-    stack->ss  = SELECTOR_U_DATA;
+    Resource::charge(thread, ResourceType::memory, 1);  //新进程不受限制,必定成功
+    InterruptStack* stack = init_user_interrupt_stack(thread, filename, (void*)(USER_STACK3_VADDR + PAGE_SIZE), 0);
+    asm volatile("movl %0, %%esp; jmp intr_exit" : : "g"(stack) : "memory");
+}
+
+/* clone出的线程的入口,在用户栈上放好entry的参数后进入用户态,
+ * arg是clone时复制到内核中的CloneArgs */
+void clone_entry(void* arg)
+{
+    CloneArgs args = *(CloneArgs*)arg;
+    Memory::free_kernel(arg);
+    PCB*      thread = Thread::get_current_pcb();
+    uint32_t* esp    = (uint32_t*)((uint32_t)args.stack_top & ~3U);
+    *--esp           = (uint32_t)args.arg;
+    *--esp           = (uint32_t)args.function;
+    *--esp           = 0;  // entry不会返回,返回地址只为占位
+    InterruptStack* stack =
+        init_user_interrupt_stack(thread, (void*)args.entry, esp, args.tls_base != 0 ? SELECTOR_U_TLS : 0);
     asm volatile("movl %0, %%esp; jmp intr_exit" : : "g"(stack) : "memory");
 }
 
+uint32_t loaded_pgd_phy_addr = 0x100000;  // cr3中当前的页目录物理地址
+
 /* 激活页表 */
 void Process::activate_page_directory(PCB* thread)
 {
@@ -70,6 +99,24 @@ void Process::activate_page_directory(PCB* thread)
 
     /* 更新页目录寄存器cr3,使新页表生效 */
     asm volatile("movl %0, %%cr3" : : "r"(pgd_phy_addr) : "memory");
+    loaded_pgd_phy_addr = pgd_phy_addr;
+}
+
+/* 切换线程时使用,与activate_page_directory不同,不会为了刷新tlb而重新加载相同的页表。
+ * 所有页目录的内核部分都相同,内核线程直接借用上一个线程的页表,
+ * 只有切换到不同的用户进程时才写cr3 */
+void Process::switch_page_directory(PCB* thread)
+{
+    if (thread->pgd == nullptr)
+    {  //页目录从不释放,借用的页表一直有效
+        return;
+    }
+    uint32_t pgd_phy_addr = (uint32_t)Memory::get_phsical_address_by_virtual_address(thread->pgd);
+    if (pgd_phy_addr != loaded_pgd_phy_addr)
+    {
+        asm volatile("movl %0, %%cr3" : : "r"(pgd_phy_addr) : "memory");
+        loaded_pgd_phy_addr = pgd_phy_addr;
+    }
 }
 
 /* 激活线程或进程的页表,更新tss中的esp0为进程的特权级0的栈 */
@@ -89,7 +136,7 @@ void Process::activate(PCB* thread)
 
 /* 创建页目录表,复制内核的pde,
  * 成功则返回页目录的虚拟地址,否则返回nullptr */
-uint32_t* create_page_dir()
+uint32_t* create_page_dir(PCB* pcb)
 {
     /* 用户进程的页表不能让用户直接访问到,所以在内核空间来申请 */
     uint32_t* page_dir_vaddr = (uint32_t*)Memory::malloc_kernel_page(1);
@@ -108,6 +155,10 @@ uint32_t* create_page_dir()
     /* 页目录地址是存入在页目录的最后一项,更新页目录地址为新页目录的物理地址 */
     page_dir_vaddr[1023] = new_page_dir_phy_addr | PG_US_U | PG_RW_W | PG_P_1;
     /*****************************************************************************/
+
+    /************************** 3  映射vdso数据页 **********************************/
+    Vdso::map(page_dir_vaddr, pcb);
+    /*****************************************************************************/
     return page_dir_vaddr;
 }
 
@@ -127,7 +178,7 @@ void Process::execute(void* filename, const char* process_name)
 {
     AtomicGuard guard;
     PCB*        pcb = Thread::create_thread(process_name, THREAD_DEFAULT_PRIORITY, process_entry, filename);
-    pcb->pgd        = create_page_dir();
+    pcb->pgd        = create_page_dir(pcb);
     create_user_vaddr_bitmap(pcb);
     Memory::init_block_descript(pcb->user_block_descript);
 }
@@ -137,21 +188,33 @@ pid_t Process::fork()
     AtomicGuard guard;
     ASSERT(Thread::is_current_user_thread());
     auto parent = Thread::get_current_pcb();
-    auto child  = (PCB*)Memory::malloc_kernel_page(1);
-    ASSERT(((uint32_t)child & 0XFFF) == 0);
-    // auto child = (PCB*)Memory::malloc_kernel(PAGE_SIZE);
+    auto child  = (PCB*)Memory::malloc_kernel(sizeof(PCB));
     ASSERT(child != nullptr);
     // auto buffer = Memory::malloc_kernel_page(1);
     auto buffer = (PCB*)Memory::malloc_kernel(PAGE_SIZE);
     ASSERT(buffer != nullptr);
 
     //处理pcb
-    memcpy(child, parent, PAGE_SIZE);
+    memcpy(child, parent, sizeof(PCB));
     child->pid        = Thread::alloc_pid();
     child->status     = TaskStatus::ready;
     child->parent_pid = parent->pid;
     child->semaphore_tag.init();
     child->thread_list_tag.init();
+    child->all_list_tag.init();
+    child->need_reschedule = false;
+    child->killed          = false;
+    child->inherited_index = RUN_QUEUE_SIZE;
+    child->held_locks      = nullptr;
+    child->waiting_lock    = nullptr;
+    child->process         = child;
+    //从clone出的线程fork时,文件表和内存建议在主线程中
+    memcpy(child->file_table, parent->process->file_table, sizeof(child->file_table));
+    memcpy(child->memory_advice, parent->process->memory_advice, sizeof(child->memory_advice));
+    memset(&child->stat, 0, sizeof(ThreadStat));
+    Resource::init_fork(child, parent);
+    child->fpu_state = nullptr;
+    FPU::init_fork(child, parent);
     Memory::init_block_descript(child->user_block_descript);
     create_user_vaddr_bitmap(child);
     ASSERT(child->user_virutal_address_pool.start_address != nullptr);
@@ -159,13 +222,14 @@ pid_t Process::fork()
            parent->user_virutal_address_pool.bitmap.start_address, child->user_virutal_address_pool.bitmap.byte_size);
 
     //处理页表
-    child->pgd = create_page_dir();
+    child->pgd = create_page_dir(child);
     ASSERT(child->pgd != nullptr);
     for (uint32_t i = 0; i < child->user_virutal_address_pool.bitmap.byte_size * 8; i++)
     {
-        if (parent->user_virutal_address_pool.bitmap.test(i))
+        uint32_t vaddr = i * PAGE_SIZE + (uint32_t)parent->user_virutal_address_pool.start_address;
+        //未映射实页的虚页(如被madvise释放)不拷贝,子进程访问时由缺页中断分配
+        if (parent->user_virutal_address_pool.bitmap.test(i) && Memory::is_page_present((void*)vaddr))
         {  //此虚页存在，把父进程的页拷贝过来
-            uint32_t vaddr = i * PAGE_SIZE + (uint32_t)parent->user_virutal_address_pool.start_address;
             memcpy(buffer, (void*)vaddr, PAGE_SIZE);
             activate_page_directory(child);  //使用子进程的页表
             Memory::malloc_physical_page_for_virtual_page(
@@ -176,8 +240,10 @@ pid_t Process::fork()
         }
     }
 
-    //处理返回值
-    InterruptStack* stack = (InterruptStack*)((uint32_t)child + PAGE_SIZE - sizeof(InterruptStack));
+    //处理返回值,子进程有自己的内核栈,复制父进程进入内核时的中断栈
+    Thread::alloc_kernel_stack(child);
+    InterruptStack* stack = (InterruptStack*)((uint32_t)child->kstack_top - sizeof(InterruptStack));
+    *stack                = *(InterruptStack*)((uint32_t)parent->kstack_top - sizeof(InterruptStack));
     stack->eax            = 0;  // eax是返回值，子进程返回0
 
     *((uint32_t*)stack - 1) = (uint32_t)intr_exit;
@@ -189,4 +255,46 @@ pid_t Process::fork()
     Memory::free_kernel(buffer);
     Thread::insert_ready_thread(child);
     return child->pid;
-}
\ No newline at end of file
+}
+
+pid_t Process::clone(const CloneArgs* args)
+{
+    ASSERT(Thread::is_current_user_thread());
+    if (!Memory::is_user_range_allocated(Thread::get_current_pcb(), (uint32_t)args, sizeof(CloneArgs)))
+    {  //args由用户传入,读取前确认它在本进程已分配的用户内存中
+        return -1;
+    }
+    //用户传入的参数在新线程运行前可能被修改,复制到内核中后再检查
+    CloneArgs* kernel_args = (CloneArgs*)Memory::malloc_kernel(sizeof(CloneArgs));
+    if (kernel_args == nullptr)
+    {
+        return -1;
+    }
+    *kernel_args = *args;
+    if (kernel_args->entry == nullptr || kernel_args->stack_top == nullptr)
+    {
+        Memory::free_kernel(kernel_args);
+        return -1;
+    }
+    //clone_entry在内核中向用户栈写入3个字,栈必须是本进程已分配的用户内存
+    uint32_t esp = (uint32_t)kernel_args->stack_top & ~3U;
+    if (esp < 3 * sizeof(uint32_t) ||
+        !Memory::is_user_range_allocated(Thread::get_current_pcb(), esp - 3 * sizeof(uint32_t), 3 * sizeof(uint32_t)))
+    {
+        Memory::free_kernel(kernel_args);
+        return -1;
+    }
+
+    AtomicGuard guard;  //新线程在设置好共享的资源前不能运行
+    PCB*        parent = Thread::get_current_pcb();
+    PCB*        child  = Thread::create_thread(parent->name, parent->priority, clone_entry, kernel_args);
+
+    child->pgd                       = parent->pgd;  //页表相同,线程间切换不重新加载cr3
+    child->process                   = parent->process;
+    child->parent_pid                = parent->pid;
+    child->tls_base                  = kernel_args->tls_base;
+    child->work_directory_inode      = parent->work_directory_inode;
+    child->user_virutal_address_pool = parent->user_virutal_address_pool;  //共享同一个位图
+    Thread::set_scheduler(child, parent->policy, parent->rt_priority);
+    return child->pid;
+}
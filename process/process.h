@@ -2,10 +2,27 @@
 
 #include "thread/thread.h"
 
+#define USER_THREAD_STACK_SIZE (2 * PAGE_SIZE)  // thread_create为线程分配的用户栈大小
+
+//clone的参数,新线程从entry(function, arg)开始在用户态运行
+struct CloneArgs
+{
+    void (*entry)(ThreadCallbackFunction_t function, void* arg);
+    ThreadCallbackFunction_t function;
+    void*                    arg;
+    void*                    stack_top;  // 用户栈的栈顶,由调用者分配
+    uint32_t                 tls_base;   // 线程局部存储段的基址,为0时不设置gs
+};
+
 namespace Process
 {
-    void  activate_page_directory(PCB* pcb);
+    //总是重新加载cr3,也用于刷新tlb
+    void activate_page_directory(PCB* pcb);
+    //切换线程时使用,页表不变时不重新加载cr3
+    void  switch_page_directory(PCB* pcb);
     void  activate(PCB* pcb);
     void  execute(void* file_name, const char* process_name);
     pid_t fork();
+    //在当前进程中创建共享页表、堆、文件表的线程,失败时返回-1
+    pid_t clone(const CloneArgs* args);
 };  // namespace Process
\ No newline at end of file
@@ -0,0 +1,149 @@
+#include "process/resource.h"
+#include "kernel/interrupt.h"
+#include "kernel/memory.h"
+#include "lib/debug.h"
+#include "lib/macro.h"
+#include "lib/string.h"
+#include "thread/thread.h"
+
+void Resource::init_pcb(PCB* pcb)
+{
+    for (auto& limit : pcb->resource_limit)
+    {
+        limit = RESOURCE_UNLIMITED;
+    }
+    memset(&pcb->resource_usage, 0, sizeof(ResourceUsage));
+}
+
+void Resource::init_fork(PCB* child, PCB* parent)
+{
+    //子进程复制了父进程所有驻留的页,内存使用量与父进程相同;使用量和限制都记在主线程中
+    memcpy(child->resource_limit, parent->process->resource_limit, sizeof(child->resource_limit));
+    memset(&child->resource_usage, 0, sizeof(ResourceUsage));
+    child->resource_usage.memory_pages = parent->process->resource_usage.memory_pages;
+}
+
+uint32_t* get_usage(PCB* pcb, ResourceType type)
+{
+    switch (type)
+    {
+        case ResourceType::memory: return &pcb->resource_usage.memory_pages;
+        case ResourceType::object: return &pcb->resource_usage.objects;
+        case ResourceType::cpu: return &pcb->resource_usage.period_ticks;
+        default: ASSERT(false); return nullptr;
+    }
+}
+
+//所有资源的限制和使用量都属于整个进程,记在主线程中
+bool Resource::charge(PCB* pcb, ResourceType type, uint32_t count)
+{
+    PCB*        owner = pcb->process;
+    AtomicGuard guard;
+    uint32_t*   usage = get_usage(owner, type);
+    uint32_t    limit = owner->resource_limit[(uint32_t)type];
+    if (*usage + count < *usage || *usage + count > limit)
+    {
+        owner->resource_usage.denied_count++;
+        return false;
+    }
+    *usage += count;
+    return true;
+}
+
+void Resource::uncharge(PCB* pcb, ResourceType type, uint32_t count)
+{
+    AtomicGuard guard;
+    uint32_t*   usage = get_usage(pcb->process, type);
+    ASSERT(*usage >= count);
+    *usage -= count;
+}
+
+bool Resource::charge_tick(PCB* pcb)
+{
+    ASSERT(!Interrupt::is_enabled());
+    PCB* owner = pcb->process;  // clone出的线程共用进程的cpu配额
+    owner->resource_usage.total_ticks++;
+    owner->resource_usage.period_ticks++;
+    if (owner->resource_usage.period_ticks < owner->resource_limit[(uint32_t)ResourceType::cpu])
+    {
+        return true;
+    }
+    pcb->resource_usage.throttled = true;  //暂停的是当前线程,进程的其他线程在运行时各自被暂停
+    owner->resource_usage.throttled_count++;
+    return false;
+}
+
+bool refill_thread_cpu_quota(PCB* pcb, void* arg)
+{
+    UNUSED(arg);
+    pcb->resource_usage.period_ticks = 0;
+    pcb->resource_usage.throttled    = false;
+    if (pcb->status == TaskStatus::hanging)
+    {  //标记后还未暂停就阻塞在其他地方或已结束的线程不能由这里唤醒
+        Thread::unblock_thread(pcb);
+    }
+    return false;
+}
+
+void Resource::refill_cpu_quota()
+{
+    ASSERT(!Interrupt::is_enabled());
+    Thread::for_each_thread(refill_thread_cpu_quota, nullptr);
+}
+
+//查找当前进程自己或子进程的pcb,找不到时返回nullptr
+PCB* find_controllable_pcb(pid_t pid)
+{
+    PCB* current = Thread::get_current_pcb();
+    if (pid == 0 || pid == current->pid)
+    {
+        return current;
+    }
+    PCB* pcb = Thread::get_pcb_by_pid(pid);
+    if (pcb == nullptr || pcb->parent_pid != current->pid || pcb->status == TaskStatus::died)
+    {
+        return nullptr;
+    }
+    return pcb;
+}
+
+int32_t Resource::setrlimit(pid_t pid, ResourceType type, uint32_t limit)
+{
+    AtomicGuard guard;
+    PCB*        pcb = find_controllable_pcb(pid);
+    if (pcb == nullptr || type >= ResourceType::max || limit == 0)
+    {
+        return -1;
+    }
+    if (limit > Thread::get_current_pcb()->process->resource_limit[(uint32_t)type])
+    {  //不能通过设置子进程来绕开自己的限制
+        return -1;
+    }
+    pcb->process->resource_limit[(uint32_t)type] = limit;
+    return 0;
+}
+
+uint32_t Resource::getrlimit(pid_t pid, ResourceType type)
+{
+    AtomicGuard guard;
+    PCB*        pcb = find_controllable_pcb(pid);
+    if (pcb == nullptr || type >= ResourceType::max)
+    {
+        return 0;
+    }
+    return pcb->process->resource_limit[(uint32_t)type];
+}
+
+int32_t Resource::getrusage(pid_t pid, ResourceUsage* usage)
+{
+    AtomicGuard guard;
+    PCB*        pcb = find_controllable_pcb(pid);
+    //usage是用户传入的指针,必须落在当前进程已分配的用户内存中
+    if (pcb == nullptr ||
+        !Memory::is_user_range_allocated(Thread::get_current_pcb(), (uint32_t)usage, sizeof(ResourceUsage)))
+    {
+        return -1;
+    }
+    *usage = pcb->process->resource_usage;
+    return 0;
+}
@@ -0,0 +1,50 @@
+#pragma once
+#include "kernel/timer.h"
+#include "lib/stdint.h"
+
+struct PCB;
+typedef int16_t pid_t;
+
+//进程可以限制的资源,限制随fork被子进程继承
+enum class ResourceType : uint32_t
+{
+    memory,  // 驻留的用户页数
+    object,  // 创建的内核对象数,目前只有管道
+    cpu,     // 每个统计周期内进程的所有线程最多运行的时钟嘀嗒数
+    max
+};
+
+#define RESOURCE_UNLIMITED 0xffffffffU           // 不限制资源
+#define CPU_QUOTA_PERIOD MSECOND_TO_TICKS(1000)  // cpu配额的统计周期,单位为时钟嘀嗒
+
+//进程的资源使用量
+struct ResourceUsage
+{
+    uint32_t memory_pages;     // 驻留的用户页数
+    uint32_t objects;          // 创建的内核对象数
+    uint32_t period_ticks;     // 本周期内已运行的嘀嗒数
+    uint32_t total_ticks;      // 总共运行的嘀嗒数
+    uint32_t throttled_count;  // 因cpu配额用尽被暂停的次数
+    uint32_t denied_count;     // 因配额不足被拒绝的申请次数
+    uint64_t runtime_ns;       // 总共运行的纳秒数,在切换线程时统计
+    bool     throttled;        // 线程是否正因cpu配额用尽被暂停,记在各线程中,其余字段记在主线程中
+};
+
+namespace Resource
+{
+    //新线程不限制资源
+    void init_pcb(PCB* pcb);
+    //fork出的子进程继承父进程的限制和内存使用量,其余使用量清零,parent可以是clone出的线程
+    void init_fork(PCB* child, PCB* parent);
+    //申请count个资源,超出限制时返回false
+    bool charge(PCB* pcb, ResourceType type, uint32_t count);
+    void uncharge(PCB* pcb, ResourceType type, uint32_t count);
+    //时钟中断中记录一个嘀嗒,cpu配额用尽时返回false
+    bool charge_tick(PCB* pcb);
+    //新的统计周期开始,恢复被暂停的线程
+    void refill_cpu_quota();
+    //pid为0表示当前进程,只能设置自己或子进程,且不能超过当前进程自己的限制
+    int32_t  setrlimit(pid_t pid, ResourceType type, uint32_t limit);
+    uint32_t getrlimit(pid_t pid, ResourceType type);
+    int32_t  getrusage(pid_t pid, ResourceUsage* usage);
+}  // namespace Resource
@@ -1,6 +1,7 @@
 #include "process/tss.h"
 #include "kernel/asm_interface.h"
 #include "kernel/boot_config.h"
+#include "kernel/interrupt.h"
 #include "lib/debug.h"
 #include "lib/stdio.h"
 #include "lib/string.h"
@@ -8,7 +9,7 @@
 #include "thread/thread.h"
 
 /* 任务状态段tss结构 */
-struct
+struct Tss
 {
     uint32_t  backlink;
     uint32_t* esp0;
@@ -37,7 +38,13 @@ struct
     uint32_t ldt;
     uint32_t trace;
     uint32_t io_base;
-} tss;
+};
+
+Tss tss;
+/* 内核栈溢出到保护页时,cpu无法在原来的栈上压入缺页的异常信息,产生双重错误,
+ * 所以双重错误通过任务门切换到独立的tss和栈上处理 */
+Tss     double_fault_tss;
+uint8_t double_fault_stack[1024];
 
 struct GdtDescript
 {
@@ -49,10 +56,18 @@ struct GdtDescript
     uint8_t  base_high_byte;
 };
 
+#define MSR_SYSENTER_CS 0x174
+#define MSR_SYSENTER_ESP 0x175
+#define MSR_SYSENTER_EIP 0x176
+#define CPUID_SEP (1 << 11)  // cpuid 1号功能edx的第11位表示支持sysenter
+
+bool     sysenter_enabled;
+uint32_t loaded_tls_base;  // gdt中线程局部存储段当前的基址
+
 /* 更新 tss 中 esp0 字段的值为 thread 的 0 级线 */
 void TSS::update_esp0(PCB* pcb)
 {
-    tss.esp0 = (uint32_t*)((uint32_t)pcb + PAGE_SIZE);
+    tss.esp0 = pcb->kstack_top;
 }
 
 GdtDescript make_gdt_descript(uint32_t* desc_addr, uint32_t limit, uint8_t attribute_low, uint8_t attribute_high)
@@ -68,6 +83,84 @@ GdtDescript make_gdt_descript(uint32_t* desc_addr, uint32_t limit, uint8_t attri
     return desc;
 }
 
+/* gs中的段描述符在加载时缓存,切换线程后返回用户态时从中断栈恢复gs,
+ * 此时才读取新的基址,所以只需改写gdt */
+void TSS::update_tls(PCB* pcb)
+{
+    if (pcb->tls_base != loaded_tls_base)
+    {
+        *((GdtDescript*)0xc0000958) =
+            make_gdt_descript((uint32_t*)pcb->tls_base, 0xfffff, GDT_DATA_ATTR_LOW_DPL3, GDT_ATTR_HIGH);
+        loaded_tls_base = pcb->tls_base;
+    }
+}
+
+//运行在double_fault_tss中,出错线程的寄存器被cpu保存在tss里
+void double_fault_handler()
+{
+    PCB*     pcb = Thread::get_current_pcb();
+    uint32_t cr2 = 0;
+    asm("movl %%cr2, %0" : "=r"(cr2));
+    printkln("\n#DF Double Fault Exception, pid: %d, name: %s, eip: %x, esp: %x", pcb->pid, pcb->name,
+             (uint32_t)tss.eip, tss.esp);
+    if (Thread::is_stack_guard(pcb, cr2))
+    {
+        printkln("kernel stack overflow, stack: %x - %x", (uint32_t)pcb->kstack_bottom, (uint32_t)pcb->kstack_top);
+    }
+    Debug::hlt();
+}
+
+void init_double_fault_tss()
+{
+    memset(&double_fault_tss, 0, sizeof(Tss));
+    double_fault_tss.cr3     = 0x100000;  // 内核的页目录
+    double_fault_tss.eip     = (uint32_t(*)())double_fault_handler;
+    double_fault_tss.esp     = (uint32_t)double_fault_stack + sizeof(double_fault_stack);
+    double_fault_tss.eflags  = 0x2;  // 关中断
+    double_fault_tss.cs      = SELECTOR_K_CODE;
+    double_fault_tss.ss      = SELECTOR_K_STACK;
+    double_fault_tss.ds      = SELECTOR_K_DATA;
+    double_fault_tss.es      = SELECTOR_K_DATA;
+    double_fault_tss.fs      = SELECTOR_K_DATA;
+    double_fault_tss.gs      = SELECTOR_K_GS;
+    double_fault_tss.io_base = sizeof(Tss);
+    *((GdtDescript*)0xc0000960) =
+        make_gdt_descript((uint32_t*)&double_fault_tss, sizeof(Tss) - 1, TSS_ATTR_LOW, TSS_ATTR_HIGH);
+    Interrupt::set_task_gate(8, SELECTOR_DF_TSS);
+}
+
+bool is_sysenter_supported()
+{
+    uint32_t eax, ebx, ecx, edx;
+    cpuid(1, &eax, &ebx, &ecx, &edx);
+    uint32_t family   = (eax >> 8) & 0xf;
+    uint32_t model    = (eax >> 4) & 0xf;
+    uint32_t stepping = eax & 0xf;
+    //早期的pentium pro虽然置了此位,但并不支持sysenter
+    return (edx & CPUID_SEP) && !(family == 6 && model < 3 && stepping < 3);
+}
+
+/* sysenter不切换栈,而是从SYSENTER_ESP加载esp,
+ * 这里指向tss的esp0字段,由入口代码再从中取出当前线程的内核栈,
+ * 这样切换线程时不需要重写msr */
+void init_sysenter()
+{
+    sysenter_enabled = is_sysenter_supported();
+    if (!sysenter_enabled)
+    {
+        printkln("sysenter is not supported, use int 0x80");
+        return;
+    }
+    wrmsr(MSR_SYSENTER_CS, SELECTOR_SYSENTER_CS);
+    wrmsr(MSR_SYSENTER_ESP, (uint32_t)&tss.esp0);
+    wrmsr(MSR_SYSENTER_EIP, (uint32_t)sysenter_handler);
+}
+
+bool TSS::is_sysenter_enabled()
+{
+    return sysenter_enabled;
+}
+
 void TSS::init()
 {
     printkln("tss init start");
@@ -84,9 +177,23 @@ void TSS::init()
     *((GdtDescript*)0xc0000928) = make_gdt_descript((uint32_t*)0, 0xfffff, GDT_CODE_ATTR_LOW_DPL3, GDT_ATTR_HIGH);
     *((GdtDescript*)0xc0000930) = make_gdt_descript((uint32_t*)0, 0xfffff, GDT_DATA_ATTR_LOW_DPL3, GDT_ATTR_HIGH);
 
+    /* 在gdt中添加sysenter和sysexit使用的4个描述符 */
+    *((GdtDescript*)0xc0000938) = make_gdt_descript((uint32_t*)0, 0xfffff, GDT_CODE_ATTR_LOW_DPL0, GDT_ATTR_HIGH);
+    *((GdtDescript*)0xc0000940) = make_gdt_descript((uint32_t*)0, 0xfffff, GDT_DATA_ATTR_LOW_DPL0, GDT_ATTR_HIGH);
+    *((GdtDescript*)0xc0000948) = make_gdt_descript((uint32_t*)0, 0xfffff, GDT_CODE_ATTR_LOW_DPL3, GDT_ATTR_HIGH);
+    *((GdtDescript*)0xc0000950) = make_gdt_descript((uint32_t*)0, 0xfffff, GDT_DATA_ATTR_LOW_DPL3, GDT_ATTR_HIGH);
+
+    /* 在gdt中添加用户线程的线程局部存储段 */
+    *((GdtDescript*)0xc0000958) = make_gdt_descript((uint32_t*)0, 0xfffff, GDT_DATA_ATTR_LOW_DPL3, GDT_ATTR_HIGH);
+    loaded_tls_base             = 0;
+
+    /* 在gdt中添加双重错误使用的tss描述符 */
+    init_double_fault_tss();
+
     /* gdt 16位的limit 32位的段基址 */
-    uint64_t gdt_operand = ((8 * 7 - 1) | ((uint64_t)(uint32_t)0xc0000900 << 16));  // 7个描述符大小
+    uint64_t gdt_operand = ((8 * 13 - 1) | ((uint64_t)(uint32_t)0xc0000900 << 16));  // 13个描述符大小
     asm volatile("lgdt %0" : : "m"(gdt_operand));
     asm volatile("ltr %w0" : : "r"(SELECTOR_TSS));
+    init_sysenter();
     printkln("tss init and ltr done");
 }
\ No newline at end of file
@@ -6,4 +6,8 @@ namespace TSS
 {
     void init();
     void update_esp0(PCB* pcb);
+    //把线程局部存储段的基址设为pcb的tls_base
+    void update_tls(PCB* pcb);
+    //处理器支持sysenter时已设置好相关的msr
+    bool is_sysenter_enabled();
 }  // namespace TSS
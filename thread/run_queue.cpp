@@ -0,0 +1,84 @@
+#include "thread/run_queue.h"
+#include "lib/debug.h"
+#include "thread/thread.h"
+
+void RunQueue::init()
+{
+    for (auto& list : queue)
+    {
+        list.init();
+    }
+    bitmap = 0;
+}
+
+uint32_t RunQueue::get_index(PCB* pcb)
+{
+    uint32_t index;
+    if (pcb->policy == SchedulePolicy::normal)
+    {
+        ASSERT(pcb->level < RUN_QUEUE_LEVELS);
+        index = RT_PRIORITY_MAX + pcb->level;
+    }
+    else
+    {
+        ASSERT(pcb->rt_priority > 0 && pcb->rt_priority <= RT_PRIORITY_MAX);
+        index = RT_PRIORITY_MAX - pcb->rt_priority;
+    }
+    return pcb->inherited_index < index ? pcb->inherited_index : index;
+}
+
+void RunQueue::push_back(PCB* pcb)
+{
+    uint32_t index = get_index(pcb);
+    queue[index].push_back(pcb->thread_list_tag);
+    bitmap |= 1U << index;
+}
+
+void RunQueue::push_front(PCB* pcb)
+{
+    uint32_t index = get_index(pcb);
+    queue[index].push_front(pcb->thread_list_tag);
+    bitmap |= 1U << index;
+}
+
+PCB* RunQueue::pop_front(uint32_t first_index)
+{
+    uint32_t mask = bitmap & ~((1U << first_index) - 1);
+    if (mask == 0)
+    {
+        return nullptr;
+    }
+    uint32_t index = __builtin_ctz(mask);
+    PCB*     pcb   = Thread::get_pcb_by_thread_list_tag(queue[index].pop_front());
+    if (queue[index].is_empty())
+    {
+        bitmap &= ~(1U << index);
+    }
+    return pcb;
+}
+
+void RunQueue::remove(PCB* pcb)
+{
+    uint32_t index = get_index(pcb);
+    ASSERT(queue[index].find(pcb->thread_list_tag));
+    pcb->thread_list_tag.remove_from_list();
+    if (queue[index].is_empty())
+    {
+        bitmap &= ~(1U << index);
+    }
+}
+
+bool RunQueue::find(PCB* pcb)
+{
+    return queue[get_index(pcb)].find(pcb->thread_list_tag);
+}
+
+bool RunQueue::is_empty()
+{
+    return bitmap == 0;
+}
+
+uint32_t RunQueue::get_highest_index()
+{
+    return bitmap == 0 ? RUN_QUEUE_SIZE : __builtin_ctz(bitmap);
+}
@@ -0,0 +1,35 @@
+#pragma once
+#include "kernel/list.h"
+#include "lib/stdint.h"
+
+struct PCB;
+
+#define RUN_QUEUE_LEVELS 8                                   // 普通线程的优先级层数,0层优先级最高
+#define RT_PRIORITY_MAX 8                                    // 实时线程的静态优先级为1到RT_PRIORITY_MAX,越大越优先
+#define USER_RT_PRIORITY_MAX (RT_PRIORITY_MAX - 1)           // 用户进程最高只能设为此优先级,RT_PRIORITY_MAX留给内核的中断工作线程
+#define RUN_QUEUE_SIZE (RT_PRIORITY_MAX + RUN_QUEUE_LEVELS)  // 实时线程的链表排在普通线程之前
+
+/* 多级就绪队列,每个优先级一个链表,用位图记录非空的链表,
+ * 取下一个线程时只需找到位图中最低的置位,与线程数无关 */
+class RunQueue
+{
+public:
+    void init();
+    //按线程的优先级放入对应链表的队尾
+    void push_back(PCB* pcb);
+    //按线程的优先级放入对应链表的队首
+    void push_front(PCB* pcb);
+    //取出下标不小于first_index的优先级最高的线程,没有时返回nullptr
+    PCB* pop_front(uint32_t first_index = 0);
+    void remove(PCB* pcb);
+    bool find(PCB* pcb);
+    bool is_empty();
+    //优先级最高的非空链表的下标,队列为空时返回RUN_QUEUE_SIZE
+    uint32_t get_highest_index();
+    //线程所在链表的下标,越小优先级越高,继承了更高的优先级时使用继承的下标
+    static uint32_t get_index(PCB* pcb);
+
+private:
+    List     queue[RUN_QUEUE_SIZE];
+    uint32_t bitmap;  // 第i位为1表示第i个链表非空
+};
@@ -1,36 +1,126 @@
 #include "thread/sync.h"
 #include "kernel/asm_interface.h"
 #include "kernel/interrupt.h"
+#include "kernel/timer.h"
 #include "lib/debug.h"
+#include "thread/run_queue.h"
 #include "thread/thread.h"
 
-Semaphore::Semaphore(uint8_t value)
+WaitQueue::WaitQueue() {}
+
+struct WaitQueueTimeout
+{
+    PCB* pcb;
+    bool timed_out;
+};
+
+//超时时线程仍在等待队列中,把它取出并唤醒
+void wait_queue_timeout(void* arg)
+{
+    WaitQueueTimeout* timeout = (WaitQueueTimeout*)arg;
+    if (timeout->pcb->semaphore_tag.next != nullptr)
+    {
+        timeout->pcb->semaphore_tag.remove_from_list();
+        timeout->timed_out = true;
+        Thread::unblock_thread(timeout->pcb);
+    }
+}
+
+bool WaitQueue::wait(uint32_t timeout)
+{
+    AtomicGuard guard;
+    PCB*        current = Thread::get_current_pcb();
+    ASSERT(current->semaphore_tag.next == nullptr);
+    waiters.push_back(current->semaphore_tag);
+    if (timeout == 0)
+    {
+        Thread::block_current_thread();
+        return true;
+    }
+    WaitQueueTimeout arg = {current, false};
+    KernelTimer      timer;  //返回前取消定时器,可以放在栈上
+    Timer::init_timer(&timer, wait_queue_timeout, &arg);
+    Timer::add_timer(&timer, timeout, 0);
+    Thread::block_current_thread();
+    Timer::cancel_timer(&timer);
+    return !arg.timed_out;
+}
+
+bool WaitQueue::wake_one()
+{
+    AtomicGuard guard;
+    if (waiters.is_empty())
+    {
+        return false;
+    }
+    Thread::unblock_thread(Thread::get_pcb_by_semaphore_tag(waiters.pop_front()));
+    return true;
+}
+
+void WaitQueue::wake_all()
+{
+    AtomicGuard guard;
+    while (wake_one()) {}
+}
+
+bool WaitQueue::is_empty()
+{
+    AtomicGuard guard;
+    return waiters.is_empty();
+}
+
+Semaphore::Semaphore(uint32_t value)
 {
     this->value = value;
 }
+
 void Semaphore::down()
 {
     AtomicGuard guard;
     while (value == 0)
     {
-        ASSERT(!waiters.find(Thread::get_current_pcb()->semaphore_tag));
-        waiters.push_back(Thread::get_current_pcb()->semaphore_tag);
-        Thread::block_current_thread();  //一直休眠直到up操作发生
+        waiters.wait();  //一直休眠直到up操作发生
     }
     value--;
-    ASSERT(value == 0);
 }
-void Semaphore::up()
+
+bool Semaphore::try_down()
 {
     AtomicGuard guard;
-    ASSERT(value == 0);
-    if (!waiters.is_empty())
+    if (value == 0)
     {
-        PCB* thread_blocked = Thread::get_pcb_by_semaphore_tag(waiters.pop_front());
-        Thread::unblock_thread(thread_blocked);
+        return false;
+    }
+    value--;
+    return true;
+}
+
+bool Semaphore::down_timeout(uint32_t timeout)
+{
+    if (timeout == 0)
+    {  //与WaitQueue::wait一致,0表示一直等待
+        down();
+        return true;
     }
+    AtomicGuard guard;
+    uint32_t    deadline = Timer::get_ticks() + timeout;
+    while (value == 0)
+    {
+        int32_t remain = (int32_t)(deadline - Timer::get_ticks());
+        if (remain <= 0 || !waiters.wait(remain))
+        {
+            return false;
+        }
+    }
+    value--;
+    return true;
+}
+
+void Semaphore::up()
+{
+    AtomicGuard guard;
     value++;
-    ASSERT(value == 1);
+    waiters.wake_one();
 }
 
 bool Semaphore::is_downed()
@@ -39,20 +129,87 @@ bool Semaphore::is_downed()
     return value == 0;
 }
 
-Lock::Lock() : holder(nullptr), semaphore(1) {}
+Lock::Lock() : holder(nullptr), next_held(nullptr) {}
+
+bool find_highest_waiter(ListElement* element, void* arg)
+{
+    PCB** highest = (PCB**)arg;
+    PCB*  pcb     = Thread::get_pcb_by_semaphore_tag(element);
+    if (*highest == nullptr || RunQueue::get_index(pcb) < RunQueue::get_index(*highest))
+    {
+        *highest = pcb;
+    }
+    return false;
+}
+
+uint32_t Lock::get_waiter_index()
+{
+    PCB* highest = nullptr;
+    waiters.for_each(find_highest_waiter, &highest);
+    return highest == nullptr ? RUN_QUEUE_SIZE : RunQueue::get_index(highest);
+}
+
+//重新计算pcb继承的优先级,有变化时沿着它等待的锁传递给锁的持有者
+void Lock::update_inherited_priority(PCB* pcb)
+{
+    while (pcb != nullptr)
+    {
+        uint32_t index = RUN_QUEUE_SIZE;
+        for (Lock* lock = pcb->held_locks; lock != nullptr; lock = lock->next_held)
+        {
+            uint32_t waiter_index = lock->get_waiter_index();
+            index                 = waiter_index < index ? waiter_index : index;
+        }
+        if (index == pcb->inherited_index)
+        {
+            break;
+        }
+        Thread::set_inherited_index(pcb, index);
+        pcb = pcb->waiting_lock == nullptr ? nullptr : pcb->waiting_lock->holder;
+    }
+}
 
 void Lock::lock()
 {
-    ASSERT(holder != Thread::get_current_pcb());
-    semaphore.down();
-    ASSERT(holder == nullptr);
-    holder = Thread::get_current_pcb();
+    AtomicGuard guard;
+    PCB*        current = Thread::get_current_pcb();
+    ASSERT(holder != current);
+    while (holder != nullptr)
+    {  //被唤醒后锁可能已被其他线程抢先获得,需要重新等待
+        current->waiting_lock = this;
+        waiters.push_back(current->semaphore_tag);
+        update_inherited_priority(holder);
+        Thread::block_current_thread();
+    }
+    current->waiting_lock = nullptr;
+    holder                = current;
+    next_held             = current->held_locks;
+    current->held_locks   = this;
+    update_inherited_priority(current);  //其余等待者的优先级传给新的持有者
 }
+
 void Lock::unlock()
 {
+    AtomicGuard guard;
     ASSERT(holder == Thread::get_current_pcb());
-    holder = nullptr;
-    semaphore.up();
+    Lock** link = &holder->held_locks;
+    while (*link != this)
+    {
+        ASSERT(*link != nullptr);
+        link = &(*link)->next_held;
+    }
+    *link     = next_held;
+    next_held = nullptr;
+    holder    = nullptr;
+
+    PCB* highest = nullptr;
+    waiters.for_each(find_highest_waiter, &highest);
+    if (highest != nullptr)
+    {  //唤醒优先级最高的等待者
+        highest->semaphore_tag.remove_from_list();
+        Thread::unblock_thread(highest);
+    }
+    update_inherited_priority(Thread::get_current_pcb());
 }
 
 bool Lock::is_locked()
@@ -60,6 +217,107 @@ bool Lock::is_locked()
     return holder != nullptr;
 }
 
+RwLock::RwLock() : readers(0), waiting_writers(0), writer(nullptr), upgrading(false) {}
+
+void RwLock::read_lock()
+{
+    AtomicGuard guard;
+    while (writer != nullptr || waiting_writers > 0 || upgrading)
+    {
+        read_queue.wait();
+    }
+    readers++;
+}
+
+void RwLock::read_unlock()
+{
+    AtomicGuard guard;
+    ASSERT(readers > 0);
+    readers--;
+    if (readers == 0 || (upgrading && readers == 1))
+    {  //只剩正在升级的读者时也要唤醒它,其他写者醒来后仍会因upgrading继续等待
+        write_queue.wake_all();
+    }
+}
+
+void RwLock::write_lock()
+{
+    AtomicGuard guard;
+    ASSERT(writer != Thread::get_current_pcb());
+    waiting_writers++;
+    while (writer != nullptr || readers > 0 || upgrading)
+    {
+        write_queue.wait();
+    }
+    waiting_writers--;
+    writer = Thread::get_current_pcb();
+}
+
+void RwLock::write_unlock()
+{
+    AtomicGuard guard;
+    ASSERT(writer == Thread::get_current_pcb());
+    writer = nullptr;
+    if (waiting_writers > 0)
+    {
+        write_queue.wake_all();
+    }
+    else
+    {
+        read_queue.wake_all();
+    }
+}
+
+bool RwLock::upgrade()
+{
+    AtomicGuard guard;
+    ASSERT(readers > 0 && writer == nullptr);
+    if (upgrading)
+    {  //两个读者同时升级会互相等待
+        return false;
+    }
+    upgrading = true;
+    while (readers > 1)
+    {
+        write_queue.wait();
+    }
+    readers--;
+    upgrading = false;
+    writer    = Thread::get_current_pcb();
+    return true;
+}
+
+void RwLock::downgrade()
+{
+    AtomicGuard guard;
+    ASSERT(writer == Thread::get_current_pcb());
+    writer = nullptr;
+    readers++;
+    if (waiting_writers == 0)
+    {
+        read_queue.wake_all();
+    }
+}
+
+bool ConditionVariable::wait(Lock& lock, uint32_t timeout)
+{
+    AtomicGuard guard;  //释放锁和进入等待之间不能发生唤醒
+    lock.unlock();
+    bool woken = waiters.wait(timeout);
+    lock.lock();
+    return woken;
+}
+
+void ConditionVariable::signal()
+{
+    waiters.wake_one();
+}
+
+void ConditionVariable::broadcast()
+{
+    waiters.wake_all();
+}
+
 LockGuard::LockGuard(Lock& lock) : plock(&lock)
 {
     plock->lock();
@@ -5,19 +5,43 @@
 
 struct PCB;
 
+/* 等待队列,线程在其中阻塞直到被唤醒或超时,用pcb的semaphore_tag挂入队列,
+ * 调用者需在关中断时检查条件并等待,避免丢失唤醒 */
+class WaitQueue
+{
+public:
+    WaitQueue();
+    //阻塞当前线程,timeout为最多等待的嘀嗒数,0表示一直等待;被唤醒时返回true,超时返回false
+    bool wait(uint32_t timeout = 0);
+    //唤醒最早等待的线程,没有等待的线程时返回false
+    bool wake_one();
+    void wake_all();
+    bool is_empty();
+
+private:
+    List waiters;
+};
+
+//计数信号量
 class Semaphore
 {
 public:
-    Semaphore(uint8_t value = 1);
+    Semaphore(uint32_t value = 1);
     void up();
     void down();
+    //value为0时不等待,直接返回false
+    bool try_down();
+    //最多等待timeout个嘀嗒,0表示一直等待,超时返回false
+    bool down_timeout(uint32_t timeout);
     bool is_downed();
 
 private:
-    uint32_t value;
-    List     waiters;
+    uint32_t  value;
+    WaitQueue waiters;
 };
 
+/* 支持优先级继承的互斥锁:等待者的优先级高于持有者时,持有者临时继承等待者的优先级,
+ * 并沿着持有者正在等待的锁继续传递,解锁时按仍持有的锁重新计算 */
 class Lock
 {
 public:
@@ -27,8 +51,52 @@ public:
     bool is_locked();
 
 private:
-    PCB*      holder;
-    Semaphore semaphore;
+    //等待者中最高的优先级对应的就绪队列下标,没有等待者时返回RUN_QUEUE_SIZE
+    uint32_t    get_waiter_index();
+    static void update_inherited_priority(PCB* pcb);
+
+    PCB*  holder;
+    Lock* next_held;  // 持有者的下一个锁
+    List  waiters;
+};
+
+/* 可睡眠的读写锁,写者优先:有写者在等待时新的读者也要等待,避免写者饿死,
+ * 适合读远多于写的数据结构 */
+class RwLock
+{
+public:
+    RwLock();
+    void read_lock();
+    void read_unlock();
+    void write_lock();
+    void write_unlock();
+    //持有读锁时升级为写锁,已有其他读者在升级时返回false,此时仍持有读锁
+    bool upgrade();
+    //持有写锁时降级为读锁,期间其他写者不能进入
+    void downgrade();
+
+private:
+    uint32_t  readers;          // 持有读锁的线程数
+    uint32_t  waiting_writers;  // 等待写锁的线程数
+    PCB*      writer;           // 持有写锁的线程
+    bool      upgrading;        // 有读者正在升级
+    WaitQueue read_queue;
+    WaitQueue write_queue;  // 等待的写者和正在升级的读者
+};
+
+//条件变量,与Lock配合使用
+class ConditionVariable
+{
+public:
+    //释放lock并等待,返回前重新获得lock;timeout为0表示一直等待,超时返回false
+    bool wait(Lock& lock, uint32_t timeout = 0);
+    //唤醒一个等待的线程
+    void signal();
+    //唤醒所有等待的线程
+    void broadcast();
+
+private:
+    WaitQueue waiters;
 };
 
 class LockGuard
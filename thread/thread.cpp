@@ -1,35 +1,54 @@
 #include "thread/thread.h"
 #include "kernel/asm_interface.h"
+#include "kernel/clock.h"
+#include "kernel/fpu.h"
 #include "kernel/interrupt.h"
 #include "kernel/log.h"
+#include "kernel/timer.h"
 #include "lib/debug.h"
 #include "lib/macro.h"
+#include "lib/math.h"
 #include "lib/stdint.h"
 #include "lib/string.h"
 #include "process/process.h"
 #include "process/tss.h"
+#include "thread/run_queue.h"
 #include "thread/sync.h"
 
 #define PCB_STACK_MAGIC 0x01234567U
-PCB* main_thread;
-PCB* idle_thread;
+#define KERNEL_STACK_FILL 0xa5                          // 新内核栈的填充值,从栈底起仍是填充值的部分从未被使用过
+#define PRIORITY_BOOST_INTERVAL MSECOND_TO_TICKS(1000)  // 每隔多少嘀嗒把所有线程提升到最高层,防止低层线程饿死
+#define TIME_SLICE_UNIT MSECOND_TO_TICKS(10)           // 普通线程的时间片以此为单位,与时钟频率无关
+#define RT_TIME_SLICE MSECOND_TO_TICKS(100)            // 实时轮转线程的时间片
+#define RT_PERIOD MSECOND_TO_TICKS(1000)               // 实时线程运行时间的统计周期
+#define RT_RUNTIME MSECOND_TO_TICKS(950)               // 每个周期内实时线程最多运行的嘀嗒数,剩余时间留给普通线程
+PCB*        main_thread;
+PCB*        idle_thread;
+uint32_t    rt_ticks;         // 本周期内实时线程已运行的嘀嗒数
+bool        rt_throttled;     // 实时线程用完了本周期的运行时间
+uint32_t    rt_period_ticks;  // 本周期开始时的嘀嗒数
+uint32_t    boost_ticks;      // 上次提升所有线程时的嘀嗒数
+uint64_t    account_ns;       // 上次统计运行时间时的纳秒时间戳
+CpuTimeType account_type;     // 当前线程正在消耗的cpu时间的类别
 
 struct ThreadPool
 {
-    List ready_list;
-    List blocked_list;
-    List running_list;
-    List deid_list;
-    Lock lock;
-};
+    RunQueue run_queue;  //就绪线程,idle线程不在其中
+    List     blocked_list;
+    List     running_list;
+    List     deid_list;
+    List     all_list;
+};  //单处理器上关中断即可保护线程池,不能使用会睡眠的锁
 ThreadPool thread_pool;
+//正在运行的线程,切换线程时更新,初始值是loader为内核主线程预留的pcb
+PCB* running_thread = (PCB*)0xc009e000;
+
+void schedule(TaskStatus next_status);
 
 //获取当前进程的PCB
 PCB* Thread::get_current_pcb()
 {
-    uint32_t esp = 0;
-    asm("mov %%esp, %0" : "=g"(esp));
-    return (PCB*)(esp & 0xfffff000);  // pcb在页的起始位置
+    return running_thread;  // pcb不再与内核栈在同一页,不能由esp得到
 }
 
 pid_t Thread::alloc_pid()
@@ -60,7 +79,26 @@ bool Thread::is_current_pcb_valid()
 //检测pcb是否合法
 bool Thread::is_pcb_valid(PCB* pcb)
 {
-    return ((((uint32_t)pcb) & 0xfffu) == 0) && pcb->stack_magic == PCB_STACK_MAGIC;
+    return pcb != nullptr && pcb->stack_magic == PCB_STACK_MAGIC;
+}
+
+bool Thread::is_stack_guard(PCB* pcb, uint32_t address)
+{
+    uint32_t bottom = (uint32_t)pcb->kstack_bottom;
+    return pcb != main_thread && bottom - PAGE_SIZE <= address && address < bottom;
+}
+
+//栈从高地址向低地址增长,从栈底向上跳过仍是填充值的字节
+uint32_t get_stack_peak(PCB* pcb)
+{
+    uint8_t* bottom = (uint8_t*)pcb->kstack_bottom;
+    uint32_t size   = (uint32_t)pcb->kstack_top - (uint32_t)bottom;
+    uint32_t unused = 0;
+    while (unused < size && bottom[unused] == KERNEL_STACK_FILL)
+    {
+        unused++;
+    }
+    return size - unused;
 }
 
 PCB* Thread::get_pcb_by_semaphore_tag(ListElement* semaphore_tag)
@@ -79,22 +117,133 @@ PCB* Thread::get_pcb_by_thread_list_tag(ListElement* thread_list_tag)
     return pcb;
 }
 
+PCB* get_pcb_by_all_list_tag(ListElement* all_list_tag)
+{
+    ASSERT(all_list_tag != nullptr);
+    PCB* pcb = (PCB*)((uint32_t)all_list_tag - (uint32_t) & ((PCB*)0)->all_list_tag);
+    ASSERT(Thread::is_pcb_valid(pcb));
+    return pcb;
+}
+
+bool is_rt_thread(PCB* pcb)
+{
+    return pcb->policy != SchedulePolicy::normal;
+}
+
+//就绪的线程优先级高于当前线程时,标记当前线程需要让出cpu
+void check_preempt(PCB* thread)
+{
+    PCB* current = Thread::get_current_pcb();
+    if (rt_throttled && is_rt_thread(thread) && !is_rt_thread(current))
+    {  //实时线程被限流期间不抢占普通线程
+        return;
+    }
+    if (RunQueue::get_index(thread) < RunQueue::get_index(current) || current == idle_thread)
+    {
+        current->need_reschedule = true;
+    }
+}
+
 void Thread::unblock_thread(PCB* thread)
 {
-    LockGuard guard(thread_pool.lock);
+    AtomicGuard guard;
     ASSERT(thread->status == TaskStatus::blocked || thread->status == TaskStatus::hanging ||
            thread->status == TaskStatus::waiting);
     if (thread->status != TaskStatus::ready)
     {
-        ASSERT(!thread_pool.ready_list.find(thread->thread_list_tag));
-        if (thread_pool.ready_list.find(thread->thread_list_tag))
+        ASSERT(!thread_pool.run_queue.find(thread));
+        if (thread_pool.run_queue.find(thread))
         {
             PANIC("thread is in ready list\n");
         }
         thread->thread_list_tag.remove_from_list();
-        thread_pool.ready_list.push_back(thread->thread_list_tag);
+        thread_pool.run_queue.push_back(thread);
         thread->status = TaskStatus::ready;
+        check_preempt(thread);
+    }
+}
+
+bool Thread::is_reschedule_needed()
+{
+    return get_current_pcb()->need_reschedule;
+}
+
+void Thread::preempt()
+{
+    PCB* pcb = get_current_pcb();
+    if (pcb->resource_usage.throttled)
+    {  // cpu配额用尽,暂停到下一个统计周期,只有refill_cpu_quota会唤醒hanging状态的线程
+        schedule(TaskStatus::hanging);
+    }
+    else if (pcb->need_reschedule)
+    {
+        yield();
+    }
+}
+
+//就绪队列中有比当前线程优先级更高的线程时,标记当前线程需要让出cpu
+void check_preempt_highest()
+{
+    PCB* current = Thread::get_current_pcb();
+    if (thread_pool.run_queue.get_highest_index() < RunQueue::get_index(current))
+    {
+        current->need_reschedule = true;
+    }
+}
+
+//线程时间片的长度,层数越低时间片越短,交互式的线程能更快地得到响应
+uint16_t get_time_slice(PCB* pcb)
+{
+    if (is_rt_thread(pcb))
+    {  // fifo线程不会因时间片用完而被切换
+        return RT_TIME_SLICE;
+    }
+    uint16_t slice = pcb->priority >> (RUN_QUEUE_LEVELS - 1 - pcb->level);
+    return (slice == 0 ? 1 : slice) * TIME_SLICE_UNIT;
+}
+
+//根据线程的行为调整所在的层:用完时间片的降一层,主动阻塞的升一层
+void adjust_level(PCB* pcb, TaskStatus next_status)
+{
+    if (pcb == idle_thread || is_rt_thread(pcb))
+    {
+        return;
+    }
+    if (next_status == TaskStatus::ready && pcb->ticks == 0)
+    {
+        if (pcb->level < RUN_QUEUE_LEVELS - 1)
+        {
+            pcb->level++;
+        }
+    }
+    else if (next_status == TaskStatus::blocked || next_status == TaskStatus::waiting ||
+             next_status == TaskStatus::hanging)
+    {
+        if (pcb->level > 0 && !pcb->resource_usage.throttled)
+        {  //因cpu配额用尽被暂停不算主动阻塞
+            pcb->level--;
+        }
+    }
+}
+
+void Thread::account_time(CpuTimeType type)
+{
+    ASSERT(!Interrupt::is_enabled());
+    PCB*     pcb = get_current_pcb();
+    uint64_t now = Clock::now_ns();
+    if (now > account_ns)
+    {  //tsc校准前后时间源不同,时间可能回退
+        uint64_t delta = now - account_ns;
+        switch (account_type)
+        {
+            case CpuTimeType::user: pcb->stat.user_ns += delta; break;
+            case CpuTimeType::kernel: pcb->stat.kernel_ns += delta; break;
+            case CpuTimeType::irq: pcb->stat.irq_ns += delta; break;
+        }
+        pcb->resource_usage.runtime_ns += delta;
     }
+    account_ns   = now;
+    account_type = type;
 }
 
 void schedule(TaskStatus next_status)
@@ -102,38 +251,88 @@ void schedule(TaskStatus next_status)
     AtomicGuard guard;
     PCB*        pcb         = Thread::get_current_pcb();
     PCB*        next_thread = nullptr;
+    //被抢占、时间片用完或cpu配额用尽时为被动切换
+    bool involuntary = pcb->need_reschedule || pcb->resource_usage.throttled;
+    Thread::account_time(CpuTimeType::kernel);  //切换线程总是发生在内核态
+    if (next_status == TaskStatus::ready && thread_pool.run_queue.is_empty())
+    {  //没有其他就绪的线程,不必出入队列,继续运行当前线程
+        adjust_level(pcb, next_status);
+        pcb->ticks           = get_time_slice(pcb);
+        pcb->need_reschedule = false;
+        return;
+    }
 
-    {  //对线程池的操作加锁
-        LockGuard guard(thread_pool.lock);
-        pcb->thread_list_tag.remove_from_list();
-        pcb->status = next_status;
-        switch (next_status)
-        {
-            case TaskStatus::ready: thread_pool.ready_list.push_back(pcb->thread_list_tag); break;
-            case TaskStatus::died: thread_pool.deid_list.push_back(pcb->thread_list_tag); break;
-            case TaskStatus::hanging: thread_pool.blocked_list.push_back(pcb->thread_list_tag); break;
-            case TaskStatus::running: ASSERT(false); break;  //错误的状态
-            case TaskStatus::waiting: thread_pool.blocked_list.push_back(pcb->thread_list_tag); break;
-            case TaskStatus::blocked: thread_pool.blocked_list.push_back(pcb->thread_list_tag); break;
-            default: ASSERT(false); break;  //错误的状态
-        }
-        ASSERT(!thread_pool.ready_list.is_empty());
-        next_thread         = Thread::get_pcb_by_thread_list_tag(thread_pool.ready_list.pop_front());
-        next_thread->ticks  = next_thread->priority;
-        next_thread->status = TaskStatus::running;
-        thread_pool.running_list.push_back(next_thread->thread_list_tag);
+    pcb->thread_list_tag.remove_from_list();
+    pcb->status = next_status;
+    adjust_level(pcb, next_status);
+    switch (next_status)
+    {
+        case TaskStatus::ready:
+            if (pcb == idle_thread)
+            {
+                break;
+            }
+            if (is_rt_thread(pcb) && pcb->ticks > 0 && pcb->need_reschedule)
+            {  //被抢占的实时线程仍排在同优先级的最前面
+                thread_pool.run_queue.push_front(pcb);
+            }
+            else
+            {
+                thread_pool.run_queue.push_back(pcb);
+            }
+            break;
+        case TaskStatus::died:
+            FPU::release(pcb);
+            thread_pool.deid_list.push_back(pcb->thread_list_tag);
+            break;
+        case TaskStatus::hanging: thread_pool.blocked_list.push_back(pcb->thread_list_tag); break;
+        case TaskStatus::running: ASSERT(false); break;  //错误的状态
+        case TaskStatus::waiting: thread_pool.blocked_list.push_back(pcb->thread_list_tag); break;
+        case TaskStatus::blocked: thread_pool.blocked_list.push_back(pcb->thread_list_tag); break;
+        default: ASSERT(false); break;  //错误的状态
+    }
+    if (rt_throttled)
+    {  //实时线程被限流时优先运行普通线程,没有普通线程时实时线程仍可运行
+        next_thread = thread_pool.run_queue.pop_front(RT_PRIORITY_MAX);
+    }
+    if (next_thread == nullptr)
+    {
+        next_thread = thread_pool.run_queue.pop_front();
+    }
+    if (next_thread == nullptr)
+    {  //没有就绪的线程时运行idle线程
+        next_thread = idle_thread;
+    }
+    next_thread->ticks  = get_time_slice(next_thread);
+    next_thread->status = TaskStatus::running;
+    thread_pool.running_list.push_back(next_thread->thread_list_tag);
+    pcb->need_reschedule = false;
+    if (next_thread == pcb)
+    {  //没有其他可运行的线程,继续运行当前线程
+        return;
+    }
+    if (involuntary)
+    {
+        pcb->stat.involuntary_switches++;
+    }
+    else
+    {
+        pcb->stat.voluntary_switches++;
     }
 
-    /* 激活该进程或线程的页表 */
-    Process::activate_page_directory(next_thread);
+    /* 切换到用户进程的页表,内核线程沿用当前页表 */
+    Process::switch_page_directory(next_thread);
     /* 内核线程特权级本身就是0,处理器进入中断时并不会从tss中获取0特权级栈地址,故不需要更新esp0 */
     // if (Thread::is_kernel_thread(pcb))
     if (Thread::is_user_thread(next_thread))
     {
         // 更新该用户进程的esp0,设置此进程被中断时的0级栈底
         TSS::update_esp0(next_thread);
+        TSS::update_tls(next_thread);
     }
+    FPU::switch_to(next_thread);
     Log::thread_switch(pcb->name, next_thread->name);
+    running_thread = next_thread;
     switch_to(pcb, next_thread);
 }
 
@@ -141,6 +340,8 @@ void Thread::init_pcb(PCB* pcb, const char* name, int priority)
 {
     memset(pcb, 0, sizeof(PCB));
     strcpy(pcb->name, name);
+    pcb->inherited_index = RUN_QUEUE_SIZE;
+    pcb->process         = pcb;
     if (pcb == main_thread)
     {
         /* 由于把main函数也封装成一个线程,并且它一直是运行的,故将其直接设为TASK_RUNNING */
@@ -151,13 +352,11 @@ void Thread::init_pcb(PCB* pcb, const char* name, int priority)
         pcb->status = TaskStatus::ready;
     }
 
-    pcb->pid           = alloc_pid();
-    pcb->priority      = priority;
-    pcb->ticks         = priority;
-    pcb->elapsed_ticks = 0;
-    pcb->pgd           = nullptr;
-    pcb->self_kstack   = (uint32_t*)((uint32_t)pcb + PAGE_SIZE);
-    pcb->stack_magic   = PCB_STACK_MAGIC;
+    pcb->pid         = alloc_pid();
+    pcb->priority    = priority;
+    pcb->ticks       = priority;
+    pcb->pgd         = nullptr;
+    pcb->stack_magic = PCB_STACK_MAGIC;
 
     /* 标准输入输出先空出来 */
     pcb->file_table[0] = 0;  // stdin
@@ -170,6 +369,7 @@ void Thread::init_pcb(PCB* pcb, const char* name, int priority)
     }
     pcb->work_directory_inode = 0;   // 以根目录做为默认工作路径
     pcb->parent_pid           = -1;  // -1表示没有父进程
+    Resource::init_pcb(pcb);
 }
 
 //创建的进程以这个函数作为入口，进入真正的函数
@@ -186,8 +386,13 @@ void idle(void* arg)
     while (true)
     {
         Thread::yield();
+        Interrupt::disable();
+        Timer::enter_idle();
         //执行hlt时必须要保证目前处在开中断的情况下
         asm volatile("sti; hlt" : : : "memory");
+        Interrupt::disable();
+        Timer::exit_idle();
+        Interrupt::enable();
     }
 }
 
@@ -195,8 +400,10 @@ void idle(void* arg)
 PCB* Thread::create_thread(const char* name, int priority, ThreadCallbackFunction_t function, void* function_arg)
 {
     /* pcb内核的数据结构,由内核来维护进程信息,因此要在内核内存池中申请 */
-    PCB* pcb = (PCB*)Memory::malloc_kernel_page(1);
+    PCB* pcb = (PCB*)Memory::malloc_kernel(sizeof(PCB));
+    ASSERT(pcb != nullptr);
     init_pcb(pcb, name, priority);
+    alloc_kernel_stack(pcb);
     pcb->self_kstack -= sizeof(InterruptStack);
     pcb->self_kstack -= sizeof(ThreadStack);
     ThreadStack* stack  = (ThreadStack*)pcb->self_kstack;
@@ -207,16 +414,86 @@ PCB* Thread::create_thread(const char* name, int priority, ThreadCallbackFunctio
     stack->ebx          = 0;
     stack->esi          = 0;
     stack->edi          = 0;
-    LockGuard gurad(thread_pool.lock);
-    thread_pool.ready_list.push_back(pcb->thread_list_tag);
+    AtomicGuard atomic_guard;
+    thread_pool.run_queue.push_back(pcb);
+    thread_pool.all_list.push_back(pcb->all_list_tag);
     return pcb;
 }
 
+void Thread::alloc_kernel_stack(PCB* pcb)
+{
+    uint32_t* bottom = (uint32_t*)Memory::malloc_kernel_stack(KERNEL_STACK_PAGES);
+    ASSERT(bottom != nullptr);
+    memset(bottom, KERNEL_STACK_FILL, KERNEL_STACK_SIZE);
+    pcb->kstack_bottom = bottom;
+    pcb->kstack_top    = (uint32_t*)((uint32_t)bottom + KERNEL_STACK_SIZE);
+    pcb->self_kstack   = pcb->kstack_top;
+}
+
 void Thread::yield()
 {
     schedule(TaskStatus::ready);
 }
 
+PCB*      yield_benchmark_thread;  // 第一次测试时创建,之后的测试复用,不会每次留下一个结束的线程
+WaitQueue yield_benchmark_wait;    // 两次测试之间partner在此等待
+bool      yield_benchmark_done;
+
+void yield_benchmark_partner(void* arg)
+{
+    UNUSED(arg);
+    while (true)
+    {
+        {
+            AtomicGuard guard;
+            while (yield_benchmark_done)
+            {
+                yield_benchmark_wait.wait();
+            }
+        }
+        while (!yield_benchmark_done)
+        {
+            Thread::yield();
+        }
+    }
+}
+
+void Thread::benchmark_yield(uint32_t rounds)
+{
+    ASSERT(rounds > 0);
+    //两个线程都设为同优先级的fifo实时线程,保证yield在两者之间严格交替
+    PCB*           current     = get_current_pcb();
+    SchedulePolicy policy      = current->policy;
+    uint8_t        rt_priority = current->rt_priority;
+    set_scheduler(current, SchedulePolicy::fifo, 1);
+    yield_benchmark_done = false;
+    if (yield_benchmark_thread == nullptr)
+    {
+        yield_benchmark_wait   = WaitQueue();
+        yield_benchmark_thread = create_thread("yield bench", 31, yield_benchmark_partner, nullptr);
+    }
+    else
+    {
+        yield_benchmark_wait.wake_one();
+    }
+    set_scheduler(yield_benchmark_thread, SchedulePolicy::fifo, 1);
+    yield();  //让对方线程先进入循环
+    uint64_t start_tsc = rdtsc();
+    uint64_t start_ns  = Clock::now_ns();
+    for (uint32_t i = 0; i < rounds; i++)
+    {
+        yield();
+    }
+    uint64_t end_tsc     = rdtsc();
+    uint64_t end_ns      = Clock::now_ns();
+    yield_benchmark_done = true;
+    yield();  //让partner回到等待队列
+    set_scheduler(yield_benchmark_thread, SchedulePolicy::normal, 0);
+    set_scheduler(current, policy, rt_priority);
+    printkln("yield round trip: %d cycles, %d ns", (uint32_t)div_u64(end_tsc - start_tsc, rounds),
+             (uint32_t)div_u64(end_ns - start_ns, rounds));
+}
+
 bool Thread::is_kernel_thread(PCB* pcb)
 {
     ASSERT(is_pcb_valid(pcb));
@@ -233,21 +510,246 @@ void Thread::block_current_thread()
 {
     schedule(TaskStatus::blocked);
 }
+
+void Thread::exit_current_thread()
+{
+    schedule(TaskStatus::died);
+    PANIC("died thread is scheduled\n");
+}
 void Thread::init()
 {
     printkln("thread init start");
     thread_pool = ThreadPool();
+    thread_pool.run_queue.init();
     main_thread = get_current_pcb();  // 0xc009e000
     ASSERT((uint32_t)main_thread == 0xc009e000);
     init_pcb(main_thread, "main", 32);
+    //主线程沿用loader设置的栈,与pcb共用一页且没有保护页,低于当前esp的部分填充,留出memset自己的栈帧
+    uint32_t esp = 0;
+    asm("mov %%esp, %0" : "=g"(esp));
+    main_thread->kstack_bottom = (uint32_t*)((uint32_t)main_thread + sizeof(PCB));
+    main_thread->kstack_top    = (uint32_t*)((uint32_t)main_thread + PAGE_SIZE);
+    memset(main_thread->kstack_bottom, KERNEL_STACK_FILL, esp - 256 - (uint32_t)main_thread->kstack_bottom);
     thread_pool.running_list.push_back(main_thread->thread_list_tag);
+    thread_pool.all_list.push_back(main_thread->all_list_tag);
     idle_thread = create_thread("idle", 32, &idle, nullptr);
+    thread_pool.run_queue.remove(idle_thread);  // idle线程只在没有就绪线程时运行
+    idle_thread->level = RUN_QUEUE_LEVELS - 1;
+    account_type       = CpuTimeType::kernel;
+    account_ns         = Clock::now_ns();
     printkln("thread init done");
 }
 
 void Thread::insert_ready_thread(PCB* pcb)
 {
     AtomicGuard gurad;
-    ASSERT(!thread_pool.ready_list.find(pcb->thread_list_tag));
-    thread_pool.ready_list.push_front(pcb->thread_list_tag);
+    ASSERT(!thread_pool.run_queue.find(pcb));
+    thread_pool.run_queue.push_front(pcb);
+    if (!thread_pool.all_list.find(pcb->all_list_tag))
+    {
+        thread_pool.all_list.push_back(pcb->all_list_tag);
+    }
+}
+
+struct ForEachThreadArg
+{
+    bool (*pfun)(PCB* pcb, void* arg);
+    void* arg;
+};
+
+bool for_each_thread_callback(ListElement* element, void* arg)
+{
+    ForEachThreadArg* for_each_arg = (ForEachThreadArg*)arg;
+    return for_each_arg->pfun(get_pcb_by_all_list_tag(element), for_each_arg->arg);
+}
+
+bool boost_thread_level(PCB* pcb, void* arg)
+{
+    UNUSED(arg);
+    if (pcb == idle_thread || is_rt_thread(pcb) || pcb->level == 0)
+    {
+        return false;
+    }
+    if (pcb->status == TaskStatus::ready)
+    {
+        thread_pool.run_queue.remove(pcb);
+        pcb->level = 0;
+        thread_pool.run_queue.push_back(pcb);
+    }
+    else
+    {
+        pcb->level = 0;
+    }
+    return false;
+}
+
+//在时钟中断中调用,返回true表示当前线程应让出cpu
+void Thread::schedule_tick(uint32_t ticks)
+{
+    ASSERT(!Interrupt::is_enabled());
+    PCB* pcb = get_current_pcb();
+    //idle时时钟可能一次前进多个嘀嗒,所以按间隔而不是按整除判断周期
+    if (ticks - boost_ticks >= PRIORITY_BOOST_INTERVAL)
+    {  //定期把所有线程提升到最高层
+        boost_ticks = ticks;
+        for_each_thread(boost_thread_level, nullptr);
+    }
+    if (ticks - rt_period_ticks >= RT_PERIOD)
+    {
+        rt_period_ticks = ticks;
+        rt_ticks        = 0;
+        if (rt_throttled)
+        {  //新的周期开始,被限流的实时线程可以再次抢占
+            rt_throttled = false;
+            check_preempt_highest();
+        }
+    }
+    if (is_rt_thread(pcb) && ++rt_ticks >= RT_RUNTIME && !rt_throttled)
+    {
+        rt_throttled         = true;
+        pcb->need_reschedule = true;
+    }
+    if (pcb->need_reschedule || pcb->policy == SchedulePolicy::fifo)
+    {
+        return;
+    }
+    if (pcb->ticks == 0)
+    {  //时间片用完
+        pcb->need_reschedule = true;
+        return;
+    }
+    pcb->ticks--;
+}
+
+struct PsArg
+{
+    ThreadInfo* info;
+    uint32_t    count;
+    uint32_t    size;
+};
+
+bool fill_thread_info(PCB* pcb, void* arg)
+{
+    PsArg* ps_arg = (PsArg*)arg;
+    if (ps_arg->size == ps_arg->count)
+    {
+        return true;
+    }
+    ThreadInfo* info   = &ps_arg->info[ps_arg->size++];
+    info->pid          = pcb->pid;
+    info->parent_pid   = pcb->parent_pid;
+    info->status       = pcb->status;
+    info->policy       = pcb->policy;
+    info->level        = pcb->level;
+    info->rt_priority  = pcb->rt_priority;
+    info->memory_pages = pcb->process->resource_usage.memory_pages;
+    info->stack_size   = (uint32_t)pcb->kstack_top - (uint32_t)pcb->kstack_bottom;
+    info->stack_peak   = get_stack_peak(pcb);
+    info->stat         = pcb->stat;
+    strcpy(info->name, pcb->name);
+    return false;
+}
+
+int32_t Thread::ps(ThreadInfo* info, uint32_t count)
+{
+    //info是用户传入的指针,必须整个落在当前进程已分配的用户内存中
+    if (info == nullptr || count == 0 || count > 0xffffffffU / sizeof(ThreadInfo) ||
+        !Memory::is_user_range_allocated(get_current_pcb(), (uint32_t)info, count * sizeof(ThreadInfo)))
+    {
+        return -1;
+    }
+    AtomicGuard guard;
+    account_time(account_type);  //把当前线程到目前为止的时间计入统计
+    PsArg arg = {info, count, 0};
+    for_each_thread(fill_thread_info, &arg);
+    return arg.size;
+}
+
+//修改线程的调度策略,policy为normal时rt_priority必须为0
+int32_t Thread::set_scheduler(PCB* pcb, SchedulePolicy policy, uint8_t rt_priority)
+{
+    if (policy == SchedulePolicy::normal ? rt_priority != 0 : (rt_priority == 0 || rt_priority > RT_PRIORITY_MAX))
+    {
+        return -1;
+    }
+    if (policy != SchedulePolicy::normal && policy != SchedulePolicy::fifo && policy != SchedulePolicy::round_robin)
+    {
+        return -1;
+    }
+    AtomicGuard guard;
+    bool        queued = pcb->status == TaskStatus::ready && pcb != idle_thread;
+    if (queued)
+    {
+        thread_pool.run_queue.remove(pcb);
+    }
+    pcb->policy      = policy;
+    pcb->rt_priority = rt_priority;
+    if (queued)
+    {
+        thread_pool.run_queue.push_back(pcb);
+        check_preempt(pcb);
+    }
+    else if (pcb == get_current_pcb())
+    {  //当前线程的优先级可能降低了
+        pcb->need_reschedule = true;
+    }
+    return 0;
+}
+
+void Thread::set_inherited_index(PCB* pcb, uint8_t index)
+{
+    AtomicGuard guard;
+    if (pcb->inherited_index == index)
+    {
+        return;
+    }
+    bool queued = pcb->status == TaskStatus::ready && pcb != idle_thread;
+    if (queued)
+    {  //就绪队列按下标存放,先用原来的下标取出
+        thread_pool.run_queue.remove(pcb);
+    }
+    pcb->inherited_index = index;
+    if (queued)
+    {
+        thread_pool.run_queue.push_back(pcb);
+        check_preempt(pcb);
+    }
+    else if (pcb == get_current_pcb())
+    {  //恢复优先级后可能有更高优先级的线程就绪
+        check_preempt_highest();
+    }
+}
+
+//只能设置自己或子进程的调度策略,pid为0表示当前进程
+int32_t Thread::sched_setscheduler(pid_t pid, SchedulePolicy policy, uint8_t rt_priority)
+{
+    PCB* current = get_current_pcb();
+    PCB* pcb     = pid == 0 ? current : get_pcb_by_pid(pid);
+    if (pcb == nullptr || (pcb != current && pcb->parent_pid != current->pid) || pcb->status == TaskStatus::died)
+    {
+        return -1;
+    }
+    if (is_user_thread(current) && rt_priority > USER_RT_PRIORITY_MAX)
+    {  //用户进程不能与中断工作线程同级,否则可以一直占用cpu,推迟中断的下半部
+        return -1;
+    }
+    return set_scheduler(pcb, policy, rt_priority);
+}
+
+bool is_pid_equal(PCB* pcb, void* pid)
+{
+    return pcb->pid == *(pid_t*)pid;
+}
+
+PCB* Thread::get_pcb_by_pid(pid_t pid)
+{
+    AtomicGuard guard;
+    return for_each_thread(is_pid_equal, &pid);
+}
+
+PCB* Thread::for_each_thread(bool (*pfun)(PCB* pcb, void* arg), void* arg)
+{
+    ForEachThreadArg for_each_arg = {pfun, arg};
+    ListElement*     element      = thread_pool.all_list.for_each(for_each_thread_callback, &for_each_arg);
+    return element == nullptr ? nullptr : get_pcb_by_all_list_tag(element);
 }
\ No newline at end of file
@@ -1,11 +1,18 @@
 #pragma once
+#include "kernel/fpu.h"
 #include "kernel/list.h"
 #include "kernel/memory.h"
 #include "lib/stdint.h"
+#include "process/resource.h"
+
+struct IoRing;
+class Lock;
 
 using ThreadCallbackFunction_t = void (*)(void*);
 typedef int16_t pid_t;
 #define MAX_FILES_OPEN_PER_THREAD 8
+#define KERNEL_STACK_PAGES 2                                // 内核栈的页数,不包括其下的保护页
+#define KERNEL_STACK_SIZE (KERNEL_STACK_PAGES * PAGE_SIZE)  // 内核栈的字节数
 
 enum class TaskStatus : uint32_t
 {
@@ -17,6 +24,48 @@ enum class TaskStatus : uint32_t
     died
 };
 
+//线程的调度策略,实时线程总是优先于普通线程
+enum class SchedulePolicy : uint8_t
+{
+    normal,      // 普通线程,按多级反馈队列调度
+    fifo,        // 实时线程,一直运行到阻塞、让出或被更高优先级的实时线程抢占
+    round_robin  // 实时线程,同优先级的线程按时间片轮转
+};
+
+//cpu时间的类别,用于统计线程的运行时间
+enum class CpuTimeType : uint8_t
+{
+    user,    // 在用户态运行
+    kernel,  // 在内核态运行,包括系统调用和异常处理
+    irq      // 处理外部中断
+};
+
+//线程的运行统计,时间在切换线程、进出中断和系统调用时用tsc精确统计
+struct ThreadStat
+{
+    uint64_t user_ns;
+    uint64_t kernel_ns;
+    uint64_t irq_ns;
+    uint32_t voluntary_switches;    // 阻塞或主动让出cpu的次数
+    uint32_t involuntary_switches;  // 被抢占或时间片用完的次数
+};
+
+//ps返回的线程信息快照
+struct ThreadInfo
+{
+    pid_t          pid;
+    pid_t          parent_pid;
+    TaskStatus     status;
+    SchedulePolicy policy;
+    uint8_t        level;
+    uint8_t        rt_priority;
+    char           name[32];
+    uint32_t       memory_pages;  // 驻留的用户页数
+    uint32_t       stack_size;    // 内核栈的字节数
+    uint32_t       stack_peak;    // 内核栈曾经使用的最大字节数
+    ThreadStat     stat;
+};
+
 /***********  线程栈thread_stack  ***********
  * 线程自己的栈,用于存储线程中待执行的函数
  * 此结构在线程自己的内核栈中位置不固定,
@@ -45,27 +94,46 @@ struct ThreadStack
 /* 进程或线程的pcb,程序控制块 */
 struct PCB
 {
-    uint32_t*  self_kstack;  // 各内核线程都用自己的内核栈
-    pid_t      pid;
-    TaskStatus status;
-    char       name[32];  //进程名称
-    uint8_t    priority;
-    uint8_t    ticks;  // 每次在处理器上执行的时间嘀嗒数
-                       /* 此任务自上cpu运行后至今占用了多少cpu嘀嗒数,
-                        * 也就是此任务执行了多久*/
-    uint32_t elapsed_ticks;
+    uint32_t*      self_kstack;  // 各内核线程都用自己的内核栈
+    pid_t          pid;
+    TaskStatus     status;
+    char           name[32];  //进程名称
+    uint8_t        priority;
+    uint8_t        level;            // 所在就绪队列的层,越小优先级越高
+    SchedulePolicy policy;           // 调度策略
+    uint8_t        rt_priority;      // 实时线程的静态优先级,越大越优先,普通线程为0
+    uint16_t       ticks;            // 每次在处理器上执行的时间嘀嗒数
+    ThreadStat     stat;             // 运行时间和切换次数
+    bool           need_reschedule;  // 时间片用完或有更高优先级的线程就绪,在中断返回或开中断时让出cpu
+    uint8_t        inherited_index;  // 从等待自己持有的锁的线程继承的就绪队列下标,RUN_QUEUE_SIZE表示没有继承
+    Lock*          held_locks;       // 持有的锁组成的单链表,用于解锁时重新计算继承的优先级
+    Lock*          waiting_lock;     // 正在等待的锁,用于把优先级沿锁的持有者传递下去
     //线程的信号量标记
     ListElement semaphore_tag;
     //线程队列标记
-    ListElement         thread_list_tag;
+    ListElement thread_list_tag;
+    //所有线程队列的标记
+    ListElement         all_list_tag;
     uint32_t*           pgd;                        // 进程页表的虚拟地址,在内核线程中为nullptr
+    PCB*                process;                    // 所属进程的主线程,进程内共享的堆、文件表和内存建议都在主线程中
+    uint32_t            tls_base;                   // 线程局部存储段的基址,clone创建的线程通过gs访问
+    FpuState*           fpu_state;                  // 浮点单元的状态,第一次使用浮点指令时分配
+    IoRing*             io_ring;                    // io_ring_setup创建的环形队列,fork后子进程使用自己的副本
+    uint32_t            io_ring_entries;            // 环形队列的项数,保存在内核中,不信任用户可写的ring->entries
     VirtualAddressPool  user_virutal_address_pool;  // 用户进程的虚拟地址
     MemoryBlockDescript user_block_descript[7];     // 用户进程内存块描述符
-    int32_t             file_table[MAX_FILES_OPEN_PER_THREAD];  // 已打开文件数组
-    uint32_t            work_directory_inode;                   // 进程所在的工作目录的inode编号
-    pid_t               parent_pid;                             // 父进程pid
-    int8_t              exit_status;                            // 进程结束时自己调用exit传入的参数
-    uint32_t            stack_magic;  // 用这串数字做栈的边界标记,用于检测栈的溢出
+    int32_t             file_table[MAX_FILES_OPEN_PER_THREAD];        // 已打开文件数组
+    MemoryAdviceRange   memory_advice[MAX_ADVICE_RANGE_PER_PROCESS];  // madvise给出的内存使用建议
+    uint32_t            resource_limit[(uint32_t)ResourceType::max];  // 资源限制
+    ResourceUsage       resource_usage;                               // 资源使用量
+    uint32_t            work_directory_inode;                         // 进程所在的工作目录的inode编号
+    pid_t               parent_pid;                                   // 父进程pid
+    int8_t              exit_status;                                  // 进程结束时自己调用exit传入的参数
+    bool                killed;         // 进程已被结束,其他线程返回用户态时退出,只在主线程中有效
+    bool                memory_fault;   // 本次系统调用中内核访问用户内存超出了内存限制,系统调用返回-1
+    uint32_t*           kstack_bottom;  // 内核栈的最低地址,其下是不映射的保护页
+    uint32_t*           kstack_top;     // 内核栈的最高地址,进入内核时中断栈在最上方
+    uint32_t            stack_magic;    // 用这串数字检查pcb是否被破坏
 };
 
 namespace Thread
@@ -81,12 +149,39 @@ namespace Thread
     bool is_pcb_valid(PCB* pcb);
     bool is_current_kernel_thread();
     void block_current_thread();
+    //结束当前线程,不再返回
+    void exit_current_thread();
     void unblock_thread(PCB* thread);
     void init_pcb(PCB* pcb, const char* name, int priority);
     //切换当前的线程
     void yield();
+    //与另一个内核线程互相yield rounds次,打印每次往返的平均开销
+    void benchmark_yield(uint32_t rounds);
     PCB* create_thread(const char* name, int priority, ThreadCallbackFunction_t function, void* function_arg);
+    //为pcb分配KERNEL_STACK_PAGES页的内核栈
+    void alloc_kernel_stack(PCB* pcb);
+    //address是否在pcb内核栈下方的保护页中
+    bool is_stack_guard(PCB* pcb, uint32_t address);
     //向file table中插入已打开的文件标识符
     pid_t alloc_pid();
     void  insert_ready_thread(PCB* pcb);
+    //有更高优先级的线程就绪,当前线程应让出cpu
+    bool is_reschedule_needed();
+    //抢占点,在中断返回前和AtomicGuard恢复开中断时调用,按需让出cpu
+    void preempt();
+    //时钟中断中调用,时间片用完时标记当前线程需要调度
+    void schedule_tick(uint32_t ticks);
+    PCB* get_pcb_by_pid(pid_t pid);
+    //内核可以直接设置任意线程的调度策略,用户进程只能通过系统调用设置自己或子进程
+    int32_t set_scheduler(PCB* pcb, SchedulePolicy policy, uint8_t rt_priority);
+    //用户进程的rt_priority不能超过USER_RT_PRIORITY_MAX
+    int32_t sched_setscheduler(pid_t pid, SchedulePolicy policy, uint8_t rt_priority);
+    //优先级继承,临时把线程提升到就绪队列下标index,传入RUN_QUEUE_SIZE恢复原来的优先级
+    void set_inherited_index(PCB* pcb, uint8_t index);
+    //切换统计的cpu时间类别,在进出中断、系统调用和切换线程时调用
+    void account_time(CpuTimeType type);
+    //把最多count个线程的信息写入info,返回写入的个数,info不是当前进程已分配的用户内存时返回-1
+    int32_t ps(ThreadInfo* info, uint32_t count);
+    //遍历所有线程,pfun返回true时停止遍历
+    PCB* for_each_thread(bool (*pfun)(PCB* pcb, void* arg), void* arg);
 };  // namespace Thread